@@ -1,7 +1,7 @@
 #include "devices/serial.h"
 #include <debug.h>
+#include <string.h>
 #include "devices/input.h"
-#include "devices/intq.h"
 #include "devices/timer.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
@@ -33,6 +33,14 @@
 #define MCR_REG (IO_BASE + 4)   /* MODEM Control Register. */
 #define LSR_REG (IO_BASE + 5)   /* Line Status Register (read-only). */
 
+/* FIFO Control Register bits. */
+#define FCR_ENABLE 0x01         /* Enable receive and transmit FIFOs. */
+#define FCR_CLEAR 0x06          /* Clear both FIFOs. */
+
+/* Depth of the 16550A transmit FIFO.  Once THR reports empty,
+   this many bytes may be written back to back. */
+#define TX_FIFO_SIZE 16
+
 /* Interrupt Enable Register bits. */
 #define IER_RECV 0x01           /* Interrupt when data received. */
 #define IER_XMIT 0x02           /* Interrupt when transmit finishes. */
@@ -51,11 +59,31 @@
 /* Transmission mode. */
 static enum { UNINIT, POLL, QUEUE } mode;
 
-/* Data to be transmitted. */
-static struct intq txq;
+/* Data to be transmitted.
+   A circular buffer written by kernel threads and drained by the
+   serial interrupt handler, always with interrupts off.  It is
+   much larger than an intq so that a whole write() to the
+   console usually fits without polling. */
+#define TXQ_SIZE 4096
+static uint8_t txq[TXQ_SIZE];
+static size_t txq_head;                 /* New data is written here. */
+static size_t txq_tail;                 /* Old data is read here. */
+
+/* A kernel thread waiting for room in the transmit queue, if
+   any, and a lock that lets only one thread wait at a time.
+   The waiter is woken once the queue is half empty, so that it
+   does not switch in for every FIFO burst. */
+static struct thread *txq_waiter;
+static struct lock txq_lock;
 
 static void set_serial (int bps);
 static void putc_poll (uint8_t);
+static bool txq_empty (void);
+static size_t txq_room (void);
+static void txq_wait (void);
+static uint8_t txq_getc (void);
+static size_t txq_write (const uint8_t *, size_t);
+static void txq_drain (void);
 static void write_ier (void);
 static intr_handler_func serial_interrupt;
 
@@ -71,7 +99,7 @@ init_poll (void)
   outb (FCR_REG, 0);                    /* Disable FIFO. */
   set_serial (115200);                  /* 115.2 kbps, N-8-1. */
   outb (MCR_REG, MCR_OUT2);             /* Required to enable interrupts. */
-  intq_init (&txq);
+  txq_head = txq_tail = 0;
   mode = POLL;
 } 
 
@@ -87,7 +115,9 @@ serial_init_queue (void)
     init_poll ();
   ASSERT (mode == POLL);
 
+  lock_init (&txq_lock);
   intr_register_ext (0x20 + 4, serial_interrupt, "serial");
+  outb (FCR_REG, FCR_ENABLE | FCR_CLEAR);
   mode = QUEUE;
   old_level = intr_disable ();
   write_ier ();
@@ -112,31 +142,81 @@ serial_putc (uint8_t byte)
     {
       /* Otherwise, queue a byte and update the interrupt enable
          register. */
-      if (old_level == INTR_OFF && intq_full (&txq)) 
+      while (txq_room () == 0) 
         {
-          /* Interrupts are off and the transmit queue is full.
-             If we wanted to wait for the queue to empty,
-             we'd have to reenable interrupts.
-             That's impolite, so we'll send a character via
-             polling instead. */
-          putc_poll (intq_getc (&txq)); 
+          if (old_level == INTR_OFF)
+            {
+              /* Interrupts are off and the transmit queue is
+                 full.  If we wanted to wait for the queue to
+                 empty, we'd have to reenable interrupts.
+                 That's impolite, so we'll send a character via
+                 polling instead. */
+              putc_poll (txq_getc ()); 
+            }
+          else
+            txq_wait ();
         }
 
-      intq_putc (&txq, byte); 
+      txq_write (&byte, 1); 
+      txq_drain ();
       write_ier ();
     }
   
   intr_set_level (old_level);
 }
 
+/* Sends the N bytes in BUF to the serial port.
+   Equivalent to calling serial_putc() for each byte, but copies
+   as much as fits into the transmit queue per interrupt-off
+   section and then lets the interrupt handler send it in
+   bursts. */
+void
+serial_putbuf (const uint8_t *buf, size_t n) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  if (mode != QUEUE)
+    {
+      if (mode == UNINIT)
+        init_poll ();
+      while (n-- > 0)
+        putc_poll (*buf++);
+    }
+  else 
+    while (n > 0) 
+      {
+        size_t copied = txq_write (buf, n);
+        buf += copied;
+        n -= copied;
+
+        /* Prime the FIFO ourselves, since a transmit interrupt
+           is only raised when THR goes empty. */
+        txq_drain ();
+        write_ier ();
+
+        if (n > 0) 
+          {
+            if (old_level == INTR_OFF)
+              {
+                /* See serial_putc(). */
+                putc_poll (txq_getc ());
+              }
+            else 
+              txq_wait ();
+          }
+      }
+  
+  intr_set_level (old_level);
+}
+
 /* Flushes anything in the serial buffer out the port in polling
    mode. */
 void
 serial_flush (void) 
 {
   enum intr_level old_level = intr_disable ();
-  while (!intq_empty (&txq))
-    putc_poll (intq_getc (&txq));
+  while (!txq_empty ())
+    putc_poll (txq_getc ());
   intr_set_level (old_level);
 }
 
@@ -182,7 +262,7 @@ write_ier (void)
 
   /* Enable transmit interrupt if we have any characters to
      transmit. */
-  if (!intq_empty (&txq))
+  if (!txq_empty ())
     ier |= IER_XMIT;
 
   /* Enable receive interrupt if we have room to store any
@@ -205,6 +285,87 @@ putc_poll (uint8_t byte)
   outb (THR_REG, byte);
 }
 
+/* Returns true if the transmit queue is empty. */
+static bool
+txq_empty (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return txq_head == txq_tail;
+}
+
+/* Returns the number of bytes that may still be added to the
+   transmit queue.  One slot stays unused so that a full queue
+   can be told apart from an empty one. */
+static size_t
+txq_room (void) 
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  return (txq_tail - txq_head - 1) & (TXQ_SIZE - 1);
+}
+
+/* Sleeps until the interrupt handler has made room in the
+   transmit queue.  Interrupts must be off, and are still off on
+   return. */
+static void
+txq_wait (void) 
+{
+  ASSERT (!intr_context ());
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  lock_acquire (&txq_lock);
+  while (txq_room () == 0)
+    {
+      txq_waiter = thread_current ();
+      thread_block ();
+    }
+  lock_release (&txq_lock);
+}
+
+/* Removes and returns the oldest byte in the transmit queue,
+   which must not be empty. */
+static uint8_t
+txq_getc (void) 
+{
+  uint8_t byte;
+
+  ASSERT (!txq_empty ());
+  byte = txq[txq_tail];
+  txq_tail = (txq_tail + 1) & (TXQ_SIZE - 1);
+  return byte;
+}
+
+/* Copies up to N bytes from BUF into the transmit queue, in at
+   most two block moves.  Returns the number of bytes copied. */
+static size_t
+txq_write (const uint8_t *buf, size_t n) 
+{
+  size_t room = txq_room ();
+  size_t first;
+
+  if (n > room)
+    n = room;
+  first = TXQ_SIZE - txq_head;
+  if (first > n)
+    first = n;
+  memcpy (txq + txq_head, buf, first);
+  memcpy (txq, buf + first, n - first);
+  txq_head = (txq_head + n) & (TXQ_SIZE - 1);
+  return n;
+}
+
+/* If the transmitter is idle, refills its FIFO from the
+   transmit queue. */
+static void
+txq_drain (void) 
+{
+  int cnt;
+
+  if ((inb (LSR_REG) & LSR_THRE) == 0)
+    return;
+  for (cnt = 0; cnt < TX_FIFO_SIZE && !txq_empty (); cnt++)
+    outb (THR_REG, txq_getc ());
+}
+
 /* Serial interrupt handler. */
 static void
 serial_interrupt (struct intr_frame *f UNUSED) 
@@ -218,10 +379,16 @@ serial_interrupt (struct intr_frame *f UNUSED)
   while (!input_full () && (inb (LSR_REG) & LSR_DR) != 0)
     input_putc (inb (RBR_REG));
 
-  /* As long as we have a byte to transmit, and the hardware is
-     ready to accept a byte for transmission, transmit a byte. */
-  while (!intq_empty (&txq) && (inb (LSR_REG) & LSR_THRE) != 0) 
-    outb (THR_REG, intq_getc (&txq));
+  /* Once the hardware has emptied its transmit FIFO, refill it
+     with a burst from the transmit queue. */
+  txq_drain ();
+
+  /* Wake up a writer waiting for room, once there is plenty. */
+  if (txq_waiter != NULL && txq_room () >= TXQ_SIZE / 2)
+    {
+      thread_unblock (txq_waiter);
+      txq_waiter = NULL;
+    }
 
   /* Update interrupt enable register based on queue status. */
   write_ier ();
@@ -20,6 +20,28 @@
 /* Number of timer ticks since OS booted. */
 static int64_t ticks;
 
+/* 8254 input frequency, and PIT counts per timer tick rounded to
+   nearest. */
+#define PIT_HZ 1193180
+#define PIT_TICK ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+
+/* Shortest and longest one-shot interval, in PIT counts.  The
+   shortest keeps a deadline in the past from causing an interrupt
+   storm; the longest is the 16-bit counter limit. */
+#define PIT_MIN 64
+#define PIT_MAX 0xffff
+
+/* See timer.h. */
+bool timer_tickless;
+
+/* One-shot mode state, accessed with interrupts off. */
+static int64_t pit_clock;       /* PIT counts since boot at last program. */
+static uint16_t pit_count;      /* Counts of current one-shot interval. */
+static bool pit_idle;           /* Idle thread waits, skip ticks? */
+
+/* Sub-tick sleepers, ordered by deadline in PIT counts. */
+static struct list hr_list;
+
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
 static unsigned loops_per_tick;
@@ -29,26 +51,68 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 
-/* Sleep list for threads */
-static struct list sleep_list;
+/* Hierarchical timer wheel of callouts.  Level L has WHEEL_SIZE
+   slots, each covering WHEEL_SIZE^L ticks, so a callout is added
+   in O(1).  Whenever level 0 wraps around, the current slot of the
+   next level is cascaded (re-added) into lower levels, so each
+   callout is moved at most WHEEL_LEVELS times before it expires.
+   Callouts too far in the future wait in wheel_overflow.
+   All of these are accessed with interrupts off. */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+static struct list wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static struct list wheel_overflow;
+static int64_t wheel_ticks;     /* Next tick to be processed. */
+
+static void wheel_insert (struct callout *);
+static void wheel_cascade (void);
+static void wheel_run (void);
+static void wake_up (void *t_);
+static int64_t wheel_next (int64_t limit);
+
+static void timer_tick (void);
+static void pit_program (uint16_t count);
+static int64_t pit_now (void);
+static void pit_reprogram (void);
+static void hr_sleep (int64_t counts);
+static void hr_run (int64_t now);
+static bool hr_less (const struct list_elem *, const struct list_elem *,
+                     void *aux);
 
 /* Sets up the 8254 Programmable Interval Timer (PIT) to
-   interrupt PIT_FREQ times per second, and registers the
-   corresponding interrupt. */
+   interrupt PIT_FREQ times per second, or for the first tick in
+   one-shot mode, and registers the corresponding interrupt. */
 void
 timer_init (void) 
 {
   /* 8254 input frequency divided by TIMER_FREQ, rounded to
      nearest. */
-  uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
+  uint16_t count = PIT_TICK;
 
-  outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
-  outb (0x40, count & 0xff);
-  outb (0x40, count >> 8);
+  list_init (&hr_list);
+  if (timer_tickless)
+    {
+      pit_clock = 0;
+      pit_program (count);
+    }
+  else
+    {
+      outb (0x43, 0x34);    /* CW: counter 0, LSB then MSB, mode 2, binary. */
+      outb (0x40, count & 0xff);
+      outb (0x40, count >> 8);
+    }
 
   intr_register_ext (0x20, timer_interrupt, "8254 Timer");
-  /* Initialize sleep list */
-  list_init (&sleep_list);
+
+  /* Initialize timer wheel */
+  int level, slot;
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    for (slot = 0; slot < WHEEL_SIZE; slot++)
+      list_init (&wheel[level][slot]);
+  list_init (&wheel_overflow);
+  wheel_ticks = 0;
 }
 
 /* Calibrates loops_per_tick, used to implement brief delays. */
@@ -101,16 +165,17 @@ timer_elapsed (int64_t then)
 void
 timer_sleep (int64_t ticks) 
 {
-  int64_t start = timer_ticks ();
-  struct thread *t = thread_current();
+  struct callout c;
   enum intr_level old_level;
   ASSERT (intr_get_level () == INTR_ON);
-  old_level = intr_disable();
-  t->ticks_wakeup = start + ticks;
-  list_insert_ordered (&sleep_list, &t->elem, 
-                       thread_less_ticks_wakeup, NULL);
-  thread_block();
-  intr_set_level(old_level);
+  if (ticks <= 0)
+    return;
+
+  /* Callout on our stack wakes us up */
+  old_level = intr_disable ();
+  timer_add_callout (&c, ticks, wake_up, thread_current ());
+  thread_block ();
+  intr_set_level (old_level);
 }
 
 /* Suspends execution for approximately MS milliseconds. */
@@ -134,6 +199,41 @@ timer_nsleep (int64_t ns)
   real_time_sleep (ns, 1000 * 1000 * 1000);
 }
 
+/* Adds callout C that calls FUNC(AUX) from the timer interrupt
+   after TICKS timer ticks.  C must not be pending already, and it
+   must stay valid until FUNC is called or C is canceled.  FUNC
+   may add C again, e.g. for periodic work. */
+void
+timer_add_callout (struct callout *c, int64_t ticks,
+                   callout_func *func, void *aux)
+{
+  enum intr_level old_level;
+
+  ASSERT (c != NULL);
+  ASSERT (func != NULL);
+
+  old_level = intr_disable ();
+  c->expires = timer_ticks () + (ticks > 0 ? ticks : 0);
+  c->func = func;
+  c->aux = aux;
+  c->pending = true;
+  wheel_insert (c);
+  intr_set_level (old_level);
+}
+
+/* Cancels callout C, if it is pending. */
+void
+timer_cancel_callout (struct callout *c)
+{
+  enum intr_level old_level = intr_disable ();
+  if (c->pending)
+    {
+      list_remove (&c->elem);
+      c->pending = false;
+    }
+  intr_set_level (old_level);
+}
+
 /* Prints timer statistics. */
 void
 timer_print_stats (void) 
@@ -141,48 +241,290 @@ timer_print_stats (void)
   printf ("Timer: %"PRId64" ticks\n", timer_ticks ());
 }
 
+/* Called by idle thread with interrupts off just before it halts.
+   In one-shot mode, the next interrupt is programmed for the next
+   callout instead of the next tick. */
+void
+timer_idle_enter (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (timer_tickless)
+    {
+      pit_idle = true;
+      pit_reprogram ();
+    }
+}
+
+/* Called by the scheduler with interrupts off whenever it
+   switches away from the idle thread.  Goes back to ticking,
+   since another thread runs now.  Ticks skipped while idle are
+   caught up by the interrupt at the next tick, which is already
+   due if any were skipped. */
+void
+timer_idle_exit (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (timer_tickless && pit_idle)
+    {
+      pit_idle = false;
+      pit_reprogram ();
+    }
+}
+
 /* Timer interrupt handler. */
 static void
 timer_interrupt (struct intr_frame *args UNUSED)
 {
-  struct thread *t;
+  if (timer_tickless)
+    {
+      /* Process every tick passed since last interrupt, there may
+         be several if idle, or none for a sub-tick sleeper */
+      int64_t now = pit_now ();
+      while ((ticks + 1) * PIT_TICK <= now)
+        timer_tick ();
+      hr_run (now);
+      pit_reprogram ();
+    }
+  else
+    timer_tick ();
+}
+
+/* Does work of one timer tick. */
+static void
+timer_tick (void)
+{
   ticks++;
   thread_tick ();
-  int64_t now = timer_ticks();
-  bool is_preempt = false;
-  thread_tick ();
 
-  /* Wake up threads that ticks_wake up is less than ticks */
-  while (!list_empty(&sleep_list)) 
-    {
-      t = list_entry(list_begin(&sleep_list), struct thread, elem);
-      if (t->ticks_wakeup > now)
-        break;        /* Short circuiting the loop */
-      else 
-        {
-          if (t->priority > thread_current ()->priority)
-            is_preempt = true;
-          list_pop_front(&sleep_list);
-          thread_unblock(t);
-        }
-    }
- 
+  /* Call expired callouts, i.e. wake up sleeping threads */
+  wheel_run ();
+
   /* Excute advanced scheduler */
   if (thread_mlfqs)
     {
       thread_incr_recent_cpu ();
-      /* For each TIMER_FREQ refresh recent_cpu for every threads */
+      /* For each TIMER_FREQ decay recent_cpu, lazily for threads
+         other than running one */
       if (ticks % TIMER_FREQ == 0) 
         {
           thread_update_load_avg ();
-          thread_update_recent_cpu_all ();
+          thread_decay_recent_cpu ();
         }
+      thread_decay_ready ();
       if (ticks % 4 == 0)
-        thread_update_priority_all ();
+        thread_update_priority_ran ();
     }
-  
-  if (is_preempt)
-    intr_yield_on_return ();
+}
+
+/* Adds callout C into the wheel slot for its expiry. */
+static void
+wheel_insert (struct callout *c)
+{
+  int64_t delta = c->expires - wheel_ticks;
+  int level;
+
+  /* Already expired, call at next tick processed */
+  if (delta < 0)
+    {
+      list_push_back (&wheel[0][wheel_ticks & WHEEL_MASK], &c->elem);
+      return;
+    }
+
+  for (level = 0; level < WHEEL_LEVELS; level++)
+    if (delta < (int64_t) 1 << (WHEEL_BITS * (level + 1)))
+      {
+        int slot = (c->expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        list_push_back (&wheel[level][slot], &c->elem);
+        return;
+      }
+  list_push_back (&wheel_overflow, &c->elem);
+}
+
+/* Re-adds callouts of the current slot of upper levels, as
+   level 0 wrapped around.  A level is cascaded only if all
+   levels below it wrapped around too. */
+static void
+wheel_cascade (void)
+{
+  struct list cascade;
+  int level;
+
+  list_init (&cascade);
+  for (level = 1; level < WHEEL_LEVELS; level++)
+    {
+      int slot = (wheel_ticks >> (WHEEL_BITS * level)) & WHEEL_MASK;
+      while (!list_empty (&wheel[level][slot]))
+        list_push_back (&cascade, list_pop_front (&wheel[level][slot]));
+      if (slot != 0)
+        break;
+    }
+  if (level == WHEEL_LEVELS)
+    while (!list_empty (&wheel_overflow))
+      list_push_back (&cascade, list_pop_front (&wheel_overflow));
+
+  while (!list_empty (&cascade))
+    wheel_insert (list_entry (list_pop_front (&cascade),
+                              struct callout, elem));
+}
+
+/* Calls every callout expired until current tick. */
+static void
+wheel_run (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (wheel_ticks <= ticks)
+    {
+      struct list expired;
+      int slot = wheel_ticks & WHEEL_MASK;
+
+      if (slot == 0)
+        wheel_cascade ();
+
+      /* Advance first, so callouts added by FUNC for current tick
+         go to next slot instead of this one */
+      list_init (&expired);
+      while (!list_empty (&wheel[0][slot]))
+        list_push_back (&expired, list_pop_front (&wheel[0][slot]));
+      wheel_ticks++;
+
+      while (!list_empty (&expired))
+        {
+          struct callout *c = list_entry (list_pop_front (&expired),
+                                          struct callout, elem);
+          c->pending = false;
+          c->func (c->aux);
+        }
+    }
+}
+
+/* Returns first tick before LIMIT that wheel_run() has work at,
+   i.e. a callout expires or wheel cascades, or LIMIT if none. */
+static int64_t
+wheel_next (int64_t limit)
+{
+  int64_t t;
+
+  for (t = wheel_ticks; t < limit; t++)
+    if ((t & WHEEL_MASK) == 0 || !list_empty (&wheel[0][t & WHEEL_MASK]))
+      return t;
+  return limit;
+}
+
+/* Programs PIT for one interrupt after COUNT PIT counts. */
+static void
+pit_program (uint16_t count)
+{
+  outb (0x43, 0x30);    /* CW: counter 0, LSB then MSB, mode 0, binary. */
+  outb (0x40, count & 0xff);
+  outb (0x40, count >> 8);
+  pit_count = count;
+}
+
+/* Returns PIT counts since boot in one-shot mode. */
+static int64_t
+pit_now (void)
+{
+  uint8_t status;
+  uint16_t count;
+
+  /* Read-back command latches status and count of counter 0. */
+  outb (0x43, 0xc2);
+  status = inb (0x40);
+  count = inb (0x40);
+  count |= inb (0x40) << 8;
+
+  /* New count not loaded yet. */
+  if (status & 0x40)
+    return pit_clock;
+  /* OUT is high once interval expired.  Counter keeps counting down
+     past zero, so wrapped count tells how long ago it expired. */
+  if (status & 0x80)
+    return pit_clock + pit_count + (uint16_t) -count;
+  return pit_clock + pit_count - count;
+}
+
+/* Programs the next one-shot interrupt: at the next tick, or at
+   the next callout if idle, or earlier for a sub-tick sleeper. */
+static void
+pit_reprogram (void)
+{
+  int64_t now = pit_now ();
+  int64_t deadline, delta;
+
+  if (pit_idle)
+    deadline = wheel_next (ticks + 1 + PIT_MAX / PIT_TICK) * PIT_TICK;
+  else
+    deadline = (ticks + 1) * PIT_TICK;
+  if (!list_empty (&hr_list))
+    {
+      struct callout *c = list_entry (list_front (&hr_list),
+                                      struct callout, elem);
+      if (c->expires < deadline)
+        deadline = c->expires;
+    }
+
+  delta = deadline - now;
+  if (delta < PIT_MIN)
+    delta = PIT_MIN;
+  if (delta > PIT_MAX)
+    delta = PIT_MAX;
+  pit_clock = now;
+  pit_program (delta);
+}
+
+/* Blocks for COUNTS PIT counts, less than a tick, in one-shot
+   mode. */
+static void
+hr_sleep (int64_t counts)
+{
+  struct callout c;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  c.expires = pit_now () + counts;
+  c.func = wake_up;
+  c.aux = thread_current ();
+  c.pending = true;
+  list_insert_ordered (&hr_list, &c.elem, hr_less, NULL);
+  if (list_front (&hr_list) == &c.elem)
+    pit_reprogram ();
+  thread_block ();
+  intr_set_level (old_level);
+}
+
+/* Calls sub-tick callouts expired until NOW. */
+static void
+hr_run (int64_t now)
+{
+  while (!list_empty (&hr_list))
+    {
+      struct callout *c = list_entry (list_front (&hr_list),
+                                      struct callout, elem);
+      if (c->expires > now)
+        break;
+      list_pop_front (&hr_list);
+      c->pending = false;
+      c->func (c->aux);
+    }
+}
+
+/* Less function for sub-tick callouts by deadline. */
+static bool
+hr_less (const struct list_elem *a, const struct list_elem *b,
+         void *aux UNUSED)
+{
+  return (list_entry (a, struct callout, elem)->expires
+          < list_entry (b, struct callout, elem)->expires);
+}
+
+/* Callout function for timer_sleep(), wakes up thread T_. */
+static void
+wake_up (void *t_)
+{
+  thread_unblock (t_);
+  if (intr_context ())
+    thread_check_yield ();
 }
 
 /* Returns true if LOOPS iterations waits for more than one timer
@@ -238,6 +580,12 @@ real_time_sleep (int64_t num, int32_t denom)
          processes. */                
       timer_sleep (ticks); 
     }
+  else if (timer_tickless)
+    {
+      /* One-shot timer can interrupt within the tick, so block
+         until then instead of spinning. */
+      hr_sleep (num * PIT_HZ / denom);
+    }
   else 
     {
       /* Otherwise, use a busy-wait loop for more accurate
@@ -2,12 +2,31 @@
 #define DEVICES_TIMER_H
 
 #include <round.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <list.h>
 
 /* Number of timer interrupts per second. */
 #define TIMER_FREQ 100
 
+/* If false (default), the timer interrupts TIMER_FREQ times a second.
+   If true, the timer is programmed in one-shot mode for the next
+   deadline, so ticks are skipped while idle and sub-tick sleeps
+   block.  Controlled by kernel command-line option "-tickless". */
+extern bool timer_tickless;
+
+/* Kernel timer.  FUNC(AUX) is called from the timer interrupt
+   when EXPIRES is reached, so it must not sleep. */
+typedef void callout_func (void *aux);
+struct callout
+  {
+    int64_t expires;            /* Tick to call FUNC. */
+    callout_func *func;         /* Function to call. */
+    void *aux;                  /* Auxiliary data for FUNC. */
+    bool pending;               /* Added and not yet called? */
+    struct list_elem elem;      /* Element in timer wheel slot. */
+  };
+
 void timer_init (void);
 void timer_calibrate (void);
 
@@ -19,6 +38,13 @@ void timer_msleep (int64_t milliseconds);
 void timer_usleep (int64_t microseconds);
 void timer_nsleep (int64_t nanoseconds);
 
+void timer_add_callout (struct callout *, int64_t ticks,
+                        callout_func *, void *aux);
+void timer_cancel_callout (struct callout *);
+
+void timer_idle_enter (void);
+void timer_idle_exit (void);
+
 void timer_print_stats (void);
 
 #endif /* devices/timer.h */
@@ -25,6 +25,8 @@ static size_t cx, cy;
    The attribute at (x,y) is fb[y][x][1]. */
 static uint8_t (*fb)[COL_CNT][2];
 
+static void putc_no_cursor (int c);
+static size_t put_run (const char *s, size_t n);
 static void clear_row (size_t y);
 static void cls (void);
 static void newline (void);
@@ -55,7 +57,79 @@ vga_putc (int c)
   enum intr_level old_level = intr_disable ();
 
   init ();
-  
+  putc_no_cursor (c);
+
+  /* Update cursor position. */
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Writes the N characters in BUFFER to the VGA text display,
+   like N calls to vga_putc(), but with the hardware cursor
+   updated only at the end.  Runs of printable characters are
+   stored a row at a time.  Interrupts are turned back on for a
+   moment after each row, so that a long buffer with many scrolls
+   does not delay them, as serial_putbuf() does per queueful. */
+void
+vga_putbuf (const char *buffer, size_t n) 
+{
+  enum intr_level old_level = intr_disable ();
+
+  init ();
+  while (n > 0)
+    {
+      size_t run = put_run (buffer, n);
+      if (run == 0)
+        {
+          putc_no_cursor ((uint8_t) *buffer);
+          run = 1;
+        }
+      buffer += run;
+      n -= run;
+
+      /* At the start of a row, possibly just scrolled, let
+         pending interrupts in. */
+      if (cx == 0 && n > 0)
+        {
+          intr_set_level (old_level);
+          intr_disable ();
+        }
+    }
+  move_cursor ();
+
+  intr_set_level (old_level);
+}
+
+/* Stores the longest prefix of the N characters in S that
+   contains no control characters and fits in the rest of the
+   current row, and returns its length. */
+static size_t
+put_run (const char *s, size_t n) 
+{
+  uint8_t (*cell)[2] = &fb[cy][cx];
+  size_t room = COL_CNT - cx;
+  size_t i;
+
+  if (n > room)
+    n = room;
+  for (i = 0; i < n && (uint8_t) s[i] >= ' '; i++)
+    {
+      cell[i][0] = s[i];
+      cell[i][1] = GRAY_ON_BLACK;
+    }
+
+  cx += i;
+  if (cx >= COL_CNT)
+    newline ();
+  return i;
+}
+
+/* Writes C to the VGA text display without moving the hardware
+   cursor.  Interrupts must be off. */
+static void
+putc_no_cursor (int c) 
+{
   switch (c) 
     {
     case '\n':
@@ -88,11 +162,6 @@ vga_putc (int c)
         newline ();
       break;
     }
-
-  /* Update cursor position. */
-  move_cursor ();
-
-  intr_set_level (old_level);
 }
 
 /* Clears the screen and moves the cursor to the upper left. */
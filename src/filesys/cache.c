@@ -3,6 +3,7 @@
 #include "devices/timer.h"
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/malloc.h"
 #include "threads/synch.h"
@@ -36,6 +37,17 @@ static void cache_refresh (void);
 /* Periodically flushes all dirty blocks */
 static void cache_periodic_refresh (void *aux UNUSED);
 
+/* Interval of periodic refresh (in ticks) */
+#define CACHE_REFRESH_TICKS 1
+
+/* Timer callout that wakes up refresh demon.  It is armed only
+ * while some block is dirty, so that an idle tickless kernel does
+ * not wake up at every tick. */
+static struct callout refresh_callout;
+static struct semaphore refresh_sema;
+static void cache_refresh_timeout (void *aux UNUSED);
+static void cache_arm_refresh (void);
+
 /* For read ahead code */
 static struct list read_ahead_list;
 
@@ -90,6 +102,7 @@ cache_init (void)
 
 	struct semaphore sem;
 	sema_init (&sem, 0);
+	sema_init (&refresh_sema, 0);
 
 	/* Make new thread for periodically refresh the dirty cache blocks */
 	thread_create ("refresh", PRI_DEFAULT, cache_periodic_refresh, (void *)&sem);
@@ -189,8 +202,9 @@ cache_write (disk_sector_t idx, const void *buffer,
 	rw_wr_lock (&temp->rwl);
 	lock_release (&cache_lock);
 
-	/* If block is not valid, read from disk to buffer cache */
-	if (!temp->is_valid)
+	/* If block is not valid, read from disk to buffer cache,
+	 * unless whole sector is overwritten anyway */
+	if (!temp->is_valid && write_bytes < DISK_SECTOR_SIZE)
 		disk_read (filesys_disk, idx, temp->buffer);
 
 	/* Copy to the cache block */
@@ -199,6 +213,7 @@ cache_write (disk_sector_t idx, const void *buffer,
 	/* Set dirty bit and valid bit, and update lru time */
 	temp->is_dirty = true;
 	temp->is_valid = true;
+	cache_arm_refresh ();
 
 	/* Update accessed time stamp */
 	temp->time = time_stamp++;
@@ -332,6 +347,7 @@ get_block (disk_sector_t idx)
 static void
 cache_refresh (void)
 {
+	bool dirty_left = false;
 	int i;
 	/* Traverse all cache block */
 	for (i = 0; i < CACHE_SIZE; ++i)
@@ -350,7 +366,13 @@ cache_refresh (void)
 			/* Unlock the writers lock */
 			rw_wr_unlock(&temp->rwl);
 		}
+		else if (temp->is_dirty)
+			dirty_left = true;
 	}
+
+	/* Blocks busy now are written back next time */
+	if (dirty_left)
+		cache_arm_refresh ();
 }
 
 
@@ -368,11 +390,12 @@ cache_periodic_refresh (void *aux UNUSED)
 {
 	struct semaphore *sem = aux;
 	sema_up ((struct semaphore *)sem);
+
 	/* This is refresh demon, run until program done. */
 	while (1)
 	{
-		/* Sleep for a while */
-		timer_usleep (10000);
+		/* Sleep until timer expires */
+		sema_down (&refresh_sema);
 
 		/* Refresh the cache */
     lock_acquire (&cache_lock);
@@ -382,6 +405,43 @@ cache_periodic_refresh (void *aux UNUSED)
 }
 
 
+/*
+ * \Internal
+ * \cache_refresh_timeout
+ * \Timer callout (interrupt context) that wakes up refresh demon
+ *
+ * \param aux unused
+ *
+ * \retval void
+ */
+static void
+cache_refresh_timeout (void *aux UNUSED)
+{
+	/* Do not pile up wake ups while refresh demon is busy */
+	if (refresh_sema.value == 0)
+		sema_up (&refresh_sema);
+}
+
+
+/*
+ * \Internal
+ * \cache_arm_refresh
+ * \Arm refresh callout, unless it is already pending
+ *
+ * \param void
+ * \retval void
+ */
+static void
+cache_arm_refresh (void)
+{
+	enum intr_level old_level = intr_disable ();
+	if (!refresh_callout.pending)
+		timer_add_callout (&refresh_callout, CACHE_REFRESH_TICKS,
+		                   cache_refresh_timeout, NULL);
+	intr_set_level (old_level);
+}
+
+
 /* Structures for read ahead requests */
 struct ahead_entry
 {
@@ -406,8 +466,7 @@ cache_read_ahead_demon (void *aux UNUSED)
 	sema_up ((struct semaphore *)sem);
 	while (1)
 	{
-		/* sleep for some periodic times */
-		timer_usleep (10000);
+		/* No need to poll, cond_wait sleeps until a request arrives */
 		lock_acquire (&lock_read_ahead);
 
 		/* Wait until list is filled */
@@ -121,6 +121,50 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads from FILE into the IOVCNT buffers of IOV in order,
+   starting at offset FILE_OFS in the file.
+   Returns the number of bytes actually read,
+   which may be less than requested if end of file is reached.
+   The file's current position is unaffected. */
+off_t
+file_readv_at (struct file *file, const struct iovec *iov, int iovcnt,
+               off_t file_ofs)
+{
+  return inode_readv_at (file->inode, iov, iovcnt, file_ofs);
+}
+
+/* Writes the IOVCNT buffers of IOV in order into FILE,
+   starting at offset FILE_OFS in the file.
+   Returns the number of bytes actually written.
+   The file's current position is unaffected. */
+off_t
+file_writev_at (struct file *file, const struct iovec *iov, int iovcnt,
+                off_t file_ofs)
+{
+  /* If given file is inode, refuse it */
+  if (inode_is_dir (file->inode))
+    return -1;
+
+  return inode_writev_at (file->inode, iov, iovcnt, file_ofs);
+}
+
+/* Copies SIZE bytes of SRC starting at offset SRC_OFS into DST
+   starting at offset DST_OFS, without going through a caller's
+   buffer.  SRC and DST must not share an inode.
+   Returns the number of bytes actually copied,
+   which may be less than SIZE if end of SRC is reached.
+   The files' current positions are unaffected. */
+off_t
+file_copy_range (struct file *dst, off_t dst_ofs, struct file *src,
+                 off_t src_ofs, off_t size)
+{
+  /* If given file is inode, refuse it */
+  if (inode_is_dir (dst->inode))
+    return -1;
+
+  return inode_copy_range (dst->inode, dst_ofs, src->inode, src_ofs, size);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
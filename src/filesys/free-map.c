@@ -9,6 +9,7 @@
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
 static struct lock free_map_lock;    /* Synch for free map */
+static size_t free_map_hint;         /* Where the next search starts. */
 
 /* Initializes the free map. */
 void
@@ -30,13 +31,18 @@ bool
 free_map_allocate (size_t cnt, disk_sector_t *sectorp) 
 {
   lock_acquire (&free_map_lock);
-  disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-  if (sector != BITMAP_ERROR
-      && free_map_file != NULL
-      && !bitmap_write (free_map, free_map_file))
+  disk_sector_t sector = bitmap_scan_from (free_map, free_map_hint, cnt,
+                                           false);
+  if (sector != BITMAP_ERROR)
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
-      sector = BITMAP_ERROR;
+      bitmap_set_multiple (free_map, sector, cnt, true);
+      if (free_map_file != NULL && !bitmap_write (free_map, free_map_file))
+        {
+          bitmap_set_multiple (free_map, sector, cnt, false); 
+          sector = BITMAP_ERROR;
+        }
+      else
+        free_map_hint = sector + cnt;
     }
   lock_release (&free_map_lock);
   if (sector != BITMAP_ERROR)
@@ -3,10 +3,12 @@
 #include <debug.h>
 #include <round.h>
 #include <string.h>
+#include <user/syscall.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "filesys/directory.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/cache.h"
 #include "threads/synch.h"
 
@@ -64,6 +66,7 @@ struct inode
     int open_cnt;                       /* Number of openers. */
     bool removed;                       /* True if deleted, false otherwise. */
     int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+    int cached_page_cnt;                /* Frames in vm page cache. */
     struct inode_disk data;             /* Inode content. */
     struct rw_lock inode_lock;          /* Inode read writer lock */
     struct rw_lock dir_lock;            /* Direcory's read writer lock */
@@ -142,6 +145,9 @@ byte_to_sector (const struct inode *inode, off_t pos,
    returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of inode objects. */
+static struct kmem_cache *inode_cache;
+
 static off_t inode_set_length (struct inode *inode, off_t size);
 
 /* internal functions for handling indexed file structure */
@@ -156,6 +162,9 @@ void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode));
+  if (inode_cache == NULL)
+    PANIC ("inode_init: cannot create inode cache");
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -223,7 +232,7 @@ inode_open (disk_sector_t sector)
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
     return NULL;
 
@@ -232,6 +241,7 @@ inode_open (disk_sector_t sector)
   inode->sector = sector;
   inode->open_cnt = 1;
   inode->deny_write_cnt = 0;
+  inode->cached_page_cnt = 0;
   inode->removed = false;
   rw_init (&inode->inode_lock);
   rw_init (&inode->dir_lock);
@@ -285,7 +295,7 @@ inode_close (struct inode *inode)
         disk_write (filesys_disk, inode->sector, &inode->data);
       }
 
-      free (inode); 
+      kmem_cache_free (inode_cache, inode); 
     }
 }
 
@@ -302,43 +312,67 @@ inode_remove (struct inode *inode)
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
 off_t
-inode_read_at (struct inode *inode, void *buffer_, 
-               off_t size, off_t offset) 
+inode_read_at (struct inode *inode, void *buffer, off_t size, off_t offset)
+{
+  struct iovec iov = {buffer, size};
+  return inode_readv_at (inode, &iov, 1, offset);
+}
+
+/* Reads from INODE into the IOVCNT buffers of IOV in order,
+   starting at position OFFSET, with a single acquisition of the
+   inode lock.  Returns the number of bytes actually read, which
+   may be less than the total size of the buffers if an error
+   occurs or end of file is reached. */
+off_t
+inode_readv_at (struct inode *inode, const struct iovec *iov, int iovcnt,
+                off_t offset)
 {
-  uint8_t *buffer = buffer_;
   off_t bytes_read = 0;
+  int i;
   rw_rd_lock (&inode->inode_lock);
   off_t len = inode_length (inode);
 
-  while (size > 0)
+  for (i = 0; i < iovcnt; i++)
   {
-      disk_sector_t ahead_idx = 0;
-      /* Disk sector to read, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset, len,
-                                                 &ahead_idx);
-      int sector_ofs = offset % DISK_SECTOR_SIZE;
-
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = len - offset;
-      int sector_left = DISK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
-
-      /* Number of bytes to actually copy out of this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
-        break;
+    uint8_t *buffer = iov[i].iov_base;
+    off_t size = iov[i].iov_len;
+    off_t buf_ofs = 0;
 
-      /* Dispatch read ahead with given ahead_idx */
-      cache_read_ahead_append (ahead_idx);
-
-      /* Read data from buffer cache */
-      cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
-
-      /* Advance. */
-      size -= chunk_size;
-      offset += chunk_size;
-      bytes_read += chunk_size;
+    while (size > 0)
+    {
+        disk_sector_t ahead_idx = 0;
+        /* Disk sector to read, starting byte offset within sector. */
+        disk_sector_t sector_idx = byte_to_sector (inode, offset, len,
+                                                   &ahead_idx);
+        if ((int) sector_idx < 0)
+          goto done;
+
+        int sector_ofs = offset % DISK_SECTOR_SIZE;
+
+        /* Bytes left in inode, bytes left in sector, lesser of the two. */
+        off_t inode_left = len - offset;
+        int sector_left = DISK_SECTOR_SIZE - sector_ofs;
+        int min_left = inode_left < sector_left ? inode_left : sector_left;
+
+        /* Number of bytes to actually copy out of this sector. */
+        int chunk_size = size < min_left ? size : min_left;
+        if (chunk_size <= 0)
+          goto done;
+
+        /* Dispatch read ahead with given ahead_idx */
+        cache_read_ahead_append (ahead_idx);
+
+        /* Read data from buffer cache */
+        cache_read (sector_idx, buffer + buf_ofs, sector_ofs, chunk_size);
+
+        /* Advance. */
+        size -= chunk_size;
+        offset += chunk_size;
+        buf_ofs += chunk_size;
+        bytes_read += chunk_size;
+    }
   }
+done:
   rw_rd_unlock (&inode->inode_lock);
 
   return bytes_read;
@@ -350,60 +384,166 @@ inode_read_at (struct inode *inode, void *buffer_,
    (Normally a write at end of file would extend the inode, but
    growth is not yet implemented.) */
 off_t
-inode_write_at (struct inode *inode, const void *buffer_, off_t size,
-                off_t offset) 
+inode_write_at (struct inode *inode, const void *buffer, off_t size,
+                off_t offset)
+{
+  struct iovec iov = {(void *) buffer, size};
+  return inode_writev_at (inode, &iov, 1, offset);
+}
+
+/* Writes the IOVCNT buffers of IOV in order into INODE, starting
+   at OFFSET, with a single acquisition of the inode lock.
+   Extends INODE if needed.  Returns the number of bytes actually
+   written, which may be less than the total size of the buffers
+   if an error occurs. */
+off_t
+inode_writev_at (struct inode *inode, const struct iovec *iov, int iovcnt,
+                 off_t offset)
 {
-  const uint8_t *buffer = buffer_;
   off_t bytes_written = 0;
+  off_t total = 0;
   off_t len = inode_length (inode);
+  int i;
 
   if (inode->deny_write_cnt)
     return 0;
 
+  for (i = 0; i < iovcnt; i++)
+    total += iov[i].iov_len;
+
   rw_wr_lock (&inode->inode_lock);
 
   /* If size + offset is larger than original size, extend it */
-  if (size + offset > inode->data.length)
+  if (total + offset > inode->data.length)
   {
-    inode_extend (&inode->data, offset + size, len);
+    inode_extend (&inode->data, offset + total, len);
     /* Update inode */
     cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
-    len = inode_set_length (inode, offset + size);
+    len = inode_set_length (inode, offset + total);
+  }
+
+  for (i = 0; i < iovcnt; i++)
+  {
+    const uint8_t *buffer = iov[i].iov_base;
+    off_t size = iov[i].iov_len;
+    off_t buf_ofs = 0;
+
+    while (size > 0)
+    {
+        /* Sector to write, starting byte offset within sector. */
+        disk_sector_t sector_idx = byte_to_sector (inode, offset, len, NULL);
+
+        if ((int) sector_idx < 0 )
+          goto done;
+        
+        int sector_ofs = offset % DISK_SECTOR_SIZE;
+
+        /* Bytes left in inode, bytes left in sector, lesser of the two. */
+        off_t inode_left = len - offset;
+        int sector_left = DISK_SECTOR_SIZE - sector_ofs;
+        int min_left = inode_left < sector_left ? inode_left : sector_left;
+
+        /* Number of bytes to actually write into this sector. */
+        int chunk_size = size < min_left ? size : min_left;
+        if (chunk_size <= 0)
+          goto done;
+
+        /* Write buffer to buffer cache */
+        cache_write (sector_idx, buffer + buf_ofs,
+                     sector_ofs, chunk_size);
+
+        /* Advance. */
+        size -= chunk_size;
+        offset += chunk_size;
+        buf_ofs += chunk_size;
+        bytes_written += chunk_size;
+    }
+  }
+done:
+  rw_wr_unlock (&inode->inode_lock);
+
+  return bytes_written;
+}
+
+/* Copies SIZE bytes of SRC starting at SRC_OFS into DST starting
+   at DST_OFS, sector by sector through the buffer cache, and
+   extends DST if needed.  SRC and DST must be different inodes.
+   Returns the number of bytes actually copied, which may be less
+   than SIZE if end of SRC is reached or an error occurs. */
+off_t
+inode_copy_range (struct inode *dst, off_t dst_ofs, struct inode *src,
+                  off_t src_ofs, off_t size)
+{
+  off_t bytes_copied = 0;
+  off_t src_len, dst_len;
+  uint8_t *bounce;
+
+  ASSERT (src != dst);
+
+  if (dst->deny_write_cnt)
+    return 0;
+  bounce = malloc (DISK_SECTOR_SIZE);
+  if (bounce == NULL)
+    return 0;
+
+  /* Lock inodes in sector order, so copies in opposite
+     directions do not deadlock. */
+  if (src->sector < dst->sector)
+    {
+      rw_rd_lock (&src->inode_lock);
+      rw_wr_lock (&dst->inode_lock);
+    }
+  else
+    {
+      rw_wr_lock (&dst->inode_lock);
+      rw_rd_lock (&src->inode_lock);
+    }
+
+  src_len = inode_length (src);
+  if (size > src_len - src_ofs)
+    size = src_len > src_ofs ? src_len - src_ofs : 0;
+
+  /* Allocate whole destination range at once */
+  dst_len = inode_length (dst);
+  if (size > 0 && dst_ofs + size > dst->data.length)
+  {
+    inode_extend (&dst->data, dst_ofs + size, dst_len);
+    cache_write (dst->sector, &dst->data, 0, DISK_SECTOR_SIZE);
+    dst_len = inode_set_length (dst, dst_ofs + size);
   }
 
   while (size > 0)
   {
-      /* Sector to write, starting byte offset within sector. */
-      disk_sector_t sector_idx = byte_to_sector (inode, offset, len, NULL);
-
-      if ((int) sector_idx < 0 )
-        return 0;
-      
-      int sector_ofs = offset % DISK_SECTOR_SIZE;
-
-      /* Bytes left in inode, bytes left in sector, lesser of the two. */
-      off_t inode_left = len - offset;
-      int sector_left = DISK_SECTOR_SIZE - sector_ofs;
-      int min_left = inode_left < sector_left ? inode_left : sector_left;
-
-      /* Number of bytes to actually write into this sector. */
-      int chunk_size = size < min_left ? size : min_left;
-      if (chunk_size <= 0)
+      disk_sector_t src_idx = byte_to_sector (src, src_ofs, src_len, NULL);
+      disk_sector_t dst_idx = byte_to_sector (dst, dst_ofs, dst_len, NULL);
+      int src_sector_ofs = src_ofs % DISK_SECTOR_SIZE;
+      int dst_sector_ofs = dst_ofs % DISK_SECTOR_SIZE;
+      int chunk_size = DISK_SECTOR_SIZE - src_sector_ofs;
+
+      if ((int) src_idx < 0 || (int) dst_idx < 0)
         break;
+      if (chunk_size > DISK_SECTOR_SIZE - dst_sector_ofs)
+        chunk_size = DISK_SECTOR_SIZE - dst_sector_ofs;
+      if (chunk_size > size)
+        chunk_size = size;
 
-      /* Write buffer to buffer cache */
-      cache_write (sector_idx, buffer + bytes_written,
-                   sector_ofs, chunk_size);
+      /* With aligned offsets this moves whole sectors, so the
+         destination sector is never read from disk. */
+      cache_read (src_idx, bounce, src_sector_ofs, chunk_size);
+      cache_write (dst_idx, bounce, dst_sector_ofs, chunk_size);
 
       /* Advance. */
       size -= chunk_size;
-      offset += chunk_size;
-      bytes_written += chunk_size;
+      src_ofs += chunk_size;
+      dst_ofs += chunk_size;
+      bytes_copied += chunk_size;
   }
 
-  rw_wr_unlock (&inode->inode_lock);
+  rw_rd_unlock (&src->inode_lock);
+  rw_wr_unlock (&dst->inode_lock);
+  free (bounce);
 
-  return bytes_written;
+  return bytes_copied;
 }
 
 /* Disables writes to INODE.
@@ -426,6 +566,24 @@ inode_allow_write (struct inode *inode)
   inode->deny_write_cnt--;
 }
 
+/* Adds DELTA to the number of INODE's pages that vm keeps in its
+   page cache because they are mmapped.  Caller must serialize
+   calls, as vm does with its frame lock. */
+void
+inode_add_cached_pages (struct inode *inode, int delta)
+{
+  inode->cached_page_cnt += delta;
+  ASSERT (inode->cached_page_cnt >= 0);
+}
+
+/* Returns true if some page of INODE may be in vm's page cache,
+   so that reads and writes must look there first. */
+bool
+inode_has_cached_pages (const struct inode *inode)
+{
+  return inode->cached_page_cnt > 0;
+}
+
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (struct inode *inode)
@@ -6,6 +6,7 @@
 #include "devices/disk.h"
 
 struct bitmap;
+struct iovec;
 
 void inode_init (void);
 bool inode_create (disk_sector_t, off_t, bool is_dir, disk_sector_t parent);
@@ -16,8 +17,16 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_readv_at (struct inode *, const struct iovec *, int iovcnt,
+                      off_t offset);
+off_t inode_writev_at (struct inode *, const struct iovec *, int iovcnt,
+                       off_t offset);
+off_t inode_copy_range (struct inode *dst, off_t dst_ofs, struct inode *src,
+                        off_t src_ofs, off_t size);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
+void inode_add_cached_pages (struct inode *, int delta);
+bool inode_has_cached_pages (const struct inode *);
 off_t inode_length (struct inode *);
 bool inode_is_dir (struct inode *inode);
 bool inode_isroot (struct inode *inode);
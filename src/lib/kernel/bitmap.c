@@ -69,6 +69,59 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns an elem_type in which the bits for bit indexes
+   START through END - 1, within the element that contains bit
+   START, are set.  END must not lie beyond that element's
+   end. */
+static inline elem_type
+range_mask (size_t start, size_t end) 
+{
+  elem_type mask = (elem_type) -1 << (start % ELEM_BITS);
+  size_t end_bits = end - start + start % ELEM_BITS;
+  if (end_bits < ELEM_BITS)
+    mask &= ((elem_type) 1 << end_bits) - 1;
+  return mask;
+}
+
+/* Returns the index of the least significant set bit in X,
+   which must be nonzero. */
+static inline size_t
+first_set (elem_type x) 
+{
+  elem_type idx;
+
+  /* See the description of the BSF instruction in [IA32-v2a]. */
+  asm ("bsfl %1, %0" : "=r" (idx) : "rm" (x) : "cc");
+  return idx;
+}
+
+/* Returns the index of the first bit in B at or after START, and
+   before END, that is set to VALUE, or END if there is none.
+   Whole elements that hold no such bit are skipped with a
+   single comparison each. */
+static size_t
+find_next (const struct bitmap *b, size_t start, size_t end, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx;
+  elem_type x;
+
+  if (start >= end)
+    return end;
+
+  idx = elem_idx (start);
+  x = (b->bits[idx] ^ flip) & ((elem_type) -1 << (start % ELEM_BITS));
+  while (x == 0)
+    {
+      if (++idx >= elem_cnt (end))
+        return end;
+      x = b->bits[idx] ^ flip;
+    }
+
+  start = idx * ELEM_BITS + first_set (x);
+  return start < end ? start : end;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -163,7 +216,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] |= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the OR instruction in [IA32-v2b]. */
-  asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  asm ("orl %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -176,7 +229,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] &= ~mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the AND instruction in [IA32-v2a]. */
-  asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+  asm ("andl %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -191,7 +244,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx)
   /* This is equivalent to `b->bits[idx] ^= mask' except that it
      is guaranteed to be atomic on a uniprocessor machine.  See
      the description of the XOR instruction in [IA32-v2b]. */
-  asm ("xorl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+  asm ("xorl %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -218,14 +271,26 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* One atomic OR or AND per element, as in bitmap_mark() and
+     bitmap_reset(). */
+  while (start < end)
+    {
+      size_t idx = elem_idx (start);
+      size_t elem_end = (idx + 1) * ELEM_BITS;
+      elem_type mask = range_mask (start, end < elem_end ? end : elem_end);
+
+      if (value)
+        asm ("orl %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
+      start = elem_end;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -251,16 +316,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return find_next (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -289,6 +349,32 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt)
 
 /* Finding set or unset bits. */
 
+/* Finds and returns the starting index of the first group of CNT
+   consecutive bits in B between START and END, exclusive, that
+   are all set to VALUE, or BITMAP_ERROR if there is none.
+   Jumps from one run of VALUE bits to the next rather than
+   trying every starting position. */
+static size_t
+scan_range (const struct bitmap *b, size_t start, size_t end, size_t cnt,
+            bool value) 
+{
+  if (cnt == 0)
+    return start;
+  while (end - start >= cnt) 
+    {
+      size_t run_end;
+
+      start = find_next (b, start, end, value);
+      if (end - start < cnt)
+        break;
+      run_end = find_next (b, start, start + cnt, !value);
+      if (run_end == start + cnt)
+        return start;
+      start = run_end;
+    }
+  return BITMAP_ERROR;
+}
+
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
@@ -299,15 +385,32 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  return scan_range (b, start, b->bit_cnt, cnt, value);
+}
+
+/* Like bitmap_scan(), but if there is no such group at or after
+   HINT, goes on to search from the beginning of B.  Passing the
+   end of the last group found as HINT gives next-fit
+   allocation, which avoids rescanning the crowded front of a
+   bitmap. */
+size_t
+bitmap_scan_from (const struct bitmap *b, size_t hint, size_t cnt, bool value) 
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+
+  if (hint > b->bit_cnt)
+    hint = 0;
+  idx = scan_range (b, hint, b->bit_cnt, cnt, value);
+  if (idx == BITMAP_ERROR && hint > 0)
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      /* A group starting before HINT may extend past it. */
+      size_t end = hint + cnt - 1;
+      idx = scan_range (b, 0, end < b->bit_cnt ? end : b->bit_cnt,
+                        cnt, value);
     }
-  return BITMAP_ERROR;
+  return idx;
 }
 
 /* Finds the first group of CNT consecutive bits in B at or after
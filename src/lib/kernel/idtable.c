@@ -0,0 +1,178 @@
+/* Id table.
+
+   See idtable.h for basic information. */
+
+#include "idtable.h"
+#include "../debug.h"
+#include "bitmap.h"
+#include "threads/malloc.h"
+
+/* Number of slots of a table's first allocation. */
+#define IDTABLE_MIN_SLOTS 8
+
+static size_t capacity (const struct idtable *);
+static bool grow (struct idtable *, size_t cnt);
+
+/* Initializes T as an empty table whose ids start at BASE. */
+void
+idtable_init (struct idtable *t, int base)
+{
+  ASSERT (t != NULL);
+  ASSERT (base >= 0);
+
+  t->slots = NULL;
+  t->used = NULL;
+  t->base = base;
+}
+
+/* Frees the memory of T, which becomes empty.  The pointers
+   stored in T are not freed. */
+void
+idtable_destroy (struct idtable *t)
+{
+  ASSERT (t != NULL);
+
+  free (t->slots);
+  if (t->used != NULL)
+    bitmap_destroy (t->used);
+  t->slots = NULL;
+  t->used = NULL;
+}
+
+/* Stores P under the lowest free id of T and returns the id, or
+   -1 if memory is exhausted. */
+int
+idtable_insert (struct idtable *t, void *p)
+{
+  size_t idx = BITMAP_ERROR;
+
+  ASSERT (t != NULL);
+  ASSERT (p != NULL);
+
+  if (t->used != NULL)
+    idx = bitmap_scan (t->used, 0, 1, false);
+  if (idx == BITMAP_ERROR)
+    {
+      idx = capacity (t);
+      if (!grow (t, idx * 2))
+        return -1;
+    }
+  bitmap_mark (t->used, idx);
+  t->slots[idx] = p;
+  return t->base + (int) idx;
+}
+
+/* Stores P under ID, which must be free, in T.  Returns false if
+   memory is exhausted. */
+bool
+idtable_insert_at (struct idtable *t, int id, void *p)
+{
+  size_t idx;
+
+  ASSERT (t != NULL);
+  ASSERT (p != NULL);
+  ASSERT (id >= t->base);
+
+  idx = id - t->base;
+  if (idx >= capacity (t))
+    {
+      size_t cnt = capacity (t) > 0 ? capacity (t) * 2 : IDTABLE_MIN_SLOTS;
+      while (cnt <= idx)
+        cnt *= 2;
+      if (!grow (t, cnt))
+        return false;
+    }
+  ASSERT (!bitmap_test (t->used, idx));
+  bitmap_mark (t->used, idx);
+  t->slots[idx] = p;
+  return true;
+}
+
+/* Returns the pointer stored under ID in T, or a null pointer if
+   ID is not in use. */
+void *
+idtable_lookup (const struct idtable *t, int id)
+{
+  size_t idx;
+
+  ASSERT (t != NULL);
+
+  if (id < t->base)
+    return NULL;
+  idx = id - t->base;
+  if (idx >= capacity (t) || !bitmap_test (t->used, idx))
+    return NULL;
+  return t->slots[idx];
+}
+
+/* Frees ID in T and returns the pointer that was stored under
+   it, or a null pointer if ID was not in use. */
+void *
+idtable_remove (struct idtable *t, int id)
+{
+  void *p = idtable_lookup (t, id);
+
+  if (p != NULL)
+    bitmap_reset (t->used, id - t->base);
+  return p;
+}
+
+/* Returns the lowest id in use in T that is ID or greater, or -1
+   if there is none.  Iterate over T with:
+
+      for (id = idtable_next (t, 0); id >= 0; id = idtable_next (t, id + 1))
+*/
+int
+idtable_next (const struct idtable *t, int id)
+{
+  size_t idx;
+
+  ASSERT (t != NULL);
+
+  if (id < t->base)
+    id = t->base;
+  if ((size_t) (id - t->base) >= capacity (t))
+    return -1;
+  idx = bitmap_scan (t->used, id - t->base, 1, true);
+  return idx != BITMAP_ERROR ? t->base + (int) idx : -1;
+}
+
+/* Returns the number of slots of T. */
+static size_t
+capacity (const struct idtable *t)
+{
+  return t->used != NULL ? bitmap_size (t->used) : 0;
+}
+
+/* Grows T to CNT slots, keeping at least IDTABLE_MIN_SLOTS.
+   Returns false if memory is exhausted, in which case T is
+   unchanged. */
+static bool
+grow (struct idtable *t, size_t cnt)
+{
+  size_t old_cnt = capacity (t);
+  struct bitmap *used;
+  void **slots;
+  size_t i;
+
+  if (cnt < IDTABLE_MIN_SLOTS)
+    cnt = IDTABLE_MIN_SLOTS;
+  ASSERT (cnt > old_cnt);
+
+  used = bitmap_create (cnt);
+  if (used == NULL)
+    return false;
+  slots = realloc (t->slots, cnt * sizeof *slots);
+  if (slots == NULL)
+    {
+      bitmap_destroy (used);
+      return false;
+    }
+  for (i = 0; i < old_cnt; i++)
+    bitmap_set (used, i, bitmap_test (t->used, i));
+  if (t->used != NULL)
+    bitmap_destroy (t->used);
+  t->slots = slots;
+  t->used = used;
+  return true;
+}
@@ -0,0 +1,35 @@
+#ifndef __LIB_KERNEL_IDTABLE_H
+#define __LIB_KERNEL_IDTABLE_H
+
+/* Id table.
+
+   Maps small integer ids, such as file descriptors, to pointers.
+   The table is an array indexed by id, which grows by doubling
+   as needed, plus a bitmap of the ids in use, so lookup is O(1)
+   and idtable_insert() hands out the lowest free id.
+
+   An initialized table allocates no memory until the first
+   insertion, so it can be embedded in a structure that is set
+   up before malloc() is available. */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Id table. */
+struct idtable
+  {
+    void **slots;               /* Pointers, indexed by id - base. */
+    struct bitmap *used;        /* Slots in use, null if none yet. */
+    int base;                   /* Smallest id. */
+  };
+
+void idtable_init (struct idtable *, int base);
+void idtable_destroy (struct idtable *);
+
+int idtable_insert (struct idtable *, void *);
+bool idtable_insert_at (struct idtable *, int id, void *);
+void *idtable_lookup (const struct idtable *, int id);
+void *idtable_remove (struct idtable *, int id);
+int idtable_next (const struct idtable *, int id);
+
+#endif /* lib/kernel/idtable.h */
@@ -0,0 +1,291 @@
+/* Open-addressed hash table.
+
+   See ohash.h for basic information. */
+
+#include "ohash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Number of slots of a table's first allocation. */
+#define OHASH_MIN_SLOTS 16
+
+/* Number of old slots moved to the new array by each insertion
+   or deletion during a resize.  The old array holds at most
+   3/4 as many entries as it has slots, and the new array may
+   take that many more insertions before it must grow again, so
+   any value above 1 empties the old array in time. */
+#define OHASH_MOVE_CNT 8
+
+static struct ohash_slot *probe (struct ohash_slot *, size_t slot_cnt,
+                                 const void *key);
+static void place (struct ohash_slot *, size_t slot_cnt,
+                   const void *key, void *value);
+static void move_old (struct ohash *, size_t cnt);
+static bool grow (struct ohash *);
+
+/* Initializes H as an empty table. */
+void
+ohash_init (struct ohash *h)
+{
+  ASSERT (h != NULL);
+
+  h->cnt = 0;
+  h->slots = NULL;
+  h->slot_cnt = 0;
+  h->used = 0;
+  h->old_slots = NULL;
+  h->old_slot_cnt = 0;
+  h->old_pos = 0;
+}
+
+/* Frees the memory of H, which becomes empty.  If DESTRUCTOR is
+   non-null, it is first called for each entry in H. */
+void
+ohash_destroy (struct ohash *h, ohash_action_func *destructor)
+{
+  ASSERT (h != NULL);
+
+  if (destructor != NULL)
+    ohash_apply (h, destructor);
+  free (h->slots);
+  free (h->old_slots);
+  ohash_init (h);
+}
+
+/* Inserts KEY, which must not be null, mapped to VALUE, which
+   must not be null either, into H.  Returns false, leaving H
+   unchanged, if KEY is already in H or memory is exhausted. */
+bool
+ohash_insert (struct ohash *h, const void *key, void *value)
+{
+  ASSERT (h != NULL);
+  ASSERT (key != NULL);
+  ASSERT (value != NULL);
+
+  if (ohash_find (h, key) != NULL)
+    return false;
+
+  move_old (h, OHASH_MOVE_CNT);
+  if ((h->used + 1) * 4 > h->slot_cnt * 3 && !grow (h)
+      && h->used + 1 >= h->slot_cnt)
+    return false;
+
+  place (h->slots, h->slot_cnt, key, value);
+  h->used++;
+  h->cnt++;
+  return true;
+}
+
+/* Returns the value that KEY maps to in H, or a null pointer if
+   KEY is not in H. */
+void *
+ohash_find (const struct ohash *h, const void *key)
+{
+  struct ohash_slot *s;
+
+  ASSERT (h != NULL);
+  ASSERT (key != NULL);
+
+  s = probe (h->slots, h->slot_cnt, key);
+  if (s == NULL)
+    s = probe (h->old_slots, h->old_slot_cnt, key);
+  return s != NULL ? s->value : NULL;
+}
+
+/* Removes KEY from H and returns the value it mapped to, or a
+   null pointer if KEY is not in H. */
+void *
+ohash_delete (struct ohash *h, const void *key)
+{
+  size_t mask = h->slot_cnt - 1;
+  struct ohash_slot *s;
+  void *value;
+  size_t i, j;
+
+  ASSERT (h != NULL);
+  ASSERT (key != NULL);
+
+  s = probe (h->old_slots, h->old_slot_cnt, key);
+  if (s != NULL)
+    {
+      /* Moving entries around in the old array could carry them
+         behind old_pos, so just mark the slot deleted. */
+      value = s->value;
+      s->value = NULL;
+      h->cnt--;
+      move_old (h, OHASH_MOVE_CNT);
+      return value;
+    }
+
+  s = probe (h->slots, h->slot_cnt, key);
+  if (s == NULL)
+    return NULL;
+  value = s->value;
+
+  /* Shift each later entry of the probe sequence whose home slot
+     does not lie cyclically in (I, J] back into the hole at I. */
+  i = s - h->slots;
+  for (j = (i + 1) & mask; h->slots[j].key != NULL; j = (j + 1) & mask)
+    {
+      size_t home = ohash_ptr (h->slots[j].key) & mask;
+      if (((j - home) & mask) >= ((j - i) & mask))
+        {
+          h->slots[i] = h->slots[j];
+          i = j;
+        }
+    }
+  h->slots[i].key = NULL;
+  h->slots[i].value = NULL;
+  h->used--;
+  h->cnt--;
+
+  move_old (h, OHASH_MOVE_CNT);
+  return value;
+}
+
+/* Calls ACTION for each entry in H, in arbitrary order.
+   ACTION must not insert into or delete from H. */
+void
+ohash_apply (struct ohash *h, ohash_action_func *action)
+{
+  size_t i;
+
+  ASSERT (h != NULL);
+  ASSERT (action != NULL);
+
+  for (i = 0; i < h->slot_cnt; i++)
+    if (h->slots[i].key != NULL)
+      action (h->slots[i].key, h->slots[i].value);
+  for (i = 0; i < h->old_slot_cnt; i++)
+    if (h->old_slots[i].value != NULL)
+      action (h->old_slots[i].key, h->old_slots[i].value);
+}
+
+/* Returns the number of entries in H. */
+size_t
+ohash_size (const struct ohash *h)
+{
+  return h->cnt;
+}
+
+/* Returns true if H contains no entries, false otherwise. */
+bool
+ohash_empty (const struct ohash *h)
+{
+  return h->cnt == 0;
+}
+
+/* Returns a hash of integer I.  Every input bit affects every
+   output bit, so keys that differ only in their high bits, such
+   as page addresses, still spread over the whole table. */
+unsigned
+ohash_int (uint32_t i)
+{
+  i ^= i >> 16;
+  i *= 0x45d9f3b;
+  i ^= i >> 16;
+  i *= 0x45d9f3b;
+  i ^= i >> 16;
+  return i;
+}
+
+/* Returns a hash of pointer P. */
+unsigned
+ohash_ptr (const void *p)
+{
+  return ohash_int ((uintptr_t) p);
+}
+
+/* Returns the slot holding KEY among the SLOT_CNT SLOTS, or a
+   null pointer if KEY is not there.  A deleted slot keeps its
+   key, so a deleted KEY is reported as not found. */
+static struct ohash_slot *
+probe (struct ohash_slot *slots, size_t slot_cnt, const void *key)
+{
+  size_t mask = slot_cnt - 1;
+  size_t i;
+
+  if (slots == NULL)
+    return NULL;
+  for (i = ohash_ptr (key) & mask; slots[i].key != NULL; i = (i + 1) & mask)
+    if (slots[i].key == key)
+      return slots[i].value != NULL ? &slots[i] : NULL;
+  return NULL;
+}
+
+/* Stores KEY and VALUE in the first empty slot of KEY's probe
+   sequence among the SLOT_CNT SLOTS, which must not be full. */
+static void
+place (struct ohash_slot *slots, size_t slot_cnt, const void *key,
+       void *value)
+{
+  size_t mask = slot_cnt - 1;
+  size_t i;
+
+  for (i = ohash_ptr (key) & mask; slots[i].key != NULL; i = (i + 1) & mask)
+    continue;
+  slots[i].key = key;
+  slots[i].value = value;
+}
+
+/* Moves up to CNT slots' worth of entries from H's old array to
+   its current one, and frees the old array once it is empty. */
+static void
+move_old (struct ohash *h, size_t cnt)
+{
+  if (h->old_slots == NULL)
+    return;
+
+  for (; cnt > 0 && h->old_pos < h->old_slot_cnt; cnt--, h->old_pos++)
+    {
+      struct ohash_slot *s = &h->old_slots[h->old_pos];
+      if (s->value != NULL)
+        {
+          /* Leave the key behind, like a deletion, so that probe
+             sequences through this slot stay intact. */
+          place (h->slots, h->slot_cnt, s->key, s->value);
+          s->value = NULL;
+          h->used++;
+        }
+    }
+
+  if (h->old_pos >= h->old_slot_cnt)
+    {
+      free (h->old_slots);
+      h->old_slots = NULL;
+      h->old_slot_cnt = 0;
+      h->old_pos = 0;
+    }
+}
+
+/* Replaces H's slot array by one twice as large, whose entries
+   are then filled in gradually by move_old().  Returns false if
+   memory is exhausted. */
+static bool
+grow (struct ohash *h)
+{
+  size_t new_cnt = h->slot_cnt > 0 ? h->slot_cnt * 2 : OHASH_MIN_SLOTS;
+  struct ohash_slot *new_slots;
+  size_t i;
+
+  /* Finish any previous resize first, so that there is only
+     ever one old array. */
+  move_old (h, SIZE_MAX);
+
+  new_slots = malloc (new_cnt * sizeof *new_slots);
+  if (new_slots == NULL)
+    return false;
+  for (i = 0; i < new_cnt; i++)
+    {
+      new_slots[i].key = NULL;
+      new_slots[i].value = NULL;
+    }
+
+  h->old_slots = h->slots;
+  h->old_slot_cnt = h->slot_cnt;
+  h->old_pos = 0;
+  h->slots = new_slots;
+  h->slot_cnt = new_cnt;
+  h->used = 0;
+  return true;
+}
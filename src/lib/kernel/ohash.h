@@ -0,0 +1,66 @@
+#ifndef __LIB_KERNEL_OHASH_H
+#define __LIB_KERNEL_OHASH_H
+
+/* Open-addressed hash table.
+
+   Maps pointer-sized keys, such as page addresses, to non-null
+   pointers.  Unlike the chained table in hash.h, each key and
+   value is stored directly in one array of slots, and collisions
+   are resolved by linear probing, so a lookup usually touches a
+   single cache line and follows no pointers.
+
+   Deletion shifts later entries of a probe sequence back into
+   the hole, so the table never fills with deleted markers.
+
+   When the table grows, the old slot array is kept and its
+   entries are moved to the new one a few at a time by later
+   insertions and deletions, so no single operation pays for
+   rehashing the whole table.  Lookups check both arrays
+   meanwhile.
+
+   An initialized table allocates no memory until the first
+   insertion, like an idtable. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* One key/value pair. */
+struct ohash_slot
+  {
+    const void *key;            /* Key, or null if slot is empty. */
+    void *value;                /* Value, or null if deleted. */
+  };
+
+/* Open-addressed hash table. */
+struct ohash
+  {
+    size_t cnt;                 /* Number of entries. */
+    struct ohash_slot *slots;   /* Slot array, null if none yet. */
+    size_t slot_cnt;            /* Number of slots, a power of 2. */
+    size_t used;                /* Occupied slots in SLOTS. */
+    struct ohash_slot *old_slots; /* Array being emptied, or null. */
+    size_t old_slot_cnt;        /* Number of slots in OLD_SLOTS. */
+    size_t old_pos;             /* Next old slot to move. */
+  };
+
+/* Performs some operation on an entry with the given KEY and
+   VALUE. */
+typedef void ohash_action_func (const void *key, void *value);
+
+void ohash_init (struct ohash *);
+void ohash_destroy (struct ohash *, ohash_action_func *);
+
+bool ohash_insert (struct ohash *, const void *key, void *value);
+void *ohash_find (const struct ohash *, const void *key);
+void *ohash_delete (struct ohash *, const void *key);
+void ohash_apply (struct ohash *, ohash_action_func *);
+
+size_t ohash_size (const struct ohash *);
+bool ohash_empty (const struct ohash *);
+
+/* Hash functions for integer and pointer keys. */
+unsigned ohash_int (uint32_t);
+unsigned ohash_ptr (const void *);
+
+#endif /* lib/kernel/ohash.h */
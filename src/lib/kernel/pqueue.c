@@ -0,0 +1,179 @@
+/* Priority queue.
+
+   See pqueue.h for basic information. */
+
+#include "pqueue.h"
+#include "../debug.h"
+
+static bool higher (struct pqueue *, const struct pqueue_elem *,
+                    const struct pqueue_elem *);
+static struct pqueue_elem *meld (struct pqueue *, struct pqueue_elem *,
+                                 struct pqueue_elem *);
+static struct pqueue_elem *merge_pairs (struct pqueue *,
+                                        struct pqueue_elem *);
+
+/* Initializes Q as an empty priority queue ordered by LESS,
+   given auxiliary data AUX. */
+void
+pqueue_init (struct pqueue *q, pqueue_less_func *less, void *aux)
+{
+  ASSERT (q != NULL);
+  ASSERT (less != NULL);
+
+  q->root = NULL;
+  q->size = 0;
+  q->seq = 0;
+  q->less = less;
+  q->aux = aux;
+}
+
+/* Inserts E into Q. */
+void
+pqueue_push (struct pqueue *q, struct pqueue_elem *e)
+{
+  ASSERT (q != NULL);
+  ASSERT (e != NULL);
+
+  e->child = e->next = e->prev = NULL;
+  e->seq = q->seq++;
+  q->root = meld (q, q->root, e);
+  q->size++;
+}
+
+/* Returns the greatest element in Q, without removing it.
+   Q must not be empty. */
+struct pqueue_elem *
+pqueue_top (struct pqueue *q)
+{
+  ASSERT (!pqueue_empty (q));
+  return q->root;
+}
+
+/* Removes and returns the greatest element in Q.
+   Q must not be empty. */
+struct pqueue_elem *
+pqueue_pop (struct pqueue *q)
+{
+  struct pqueue_elem *top;
+
+  ASSERT (!pqueue_empty (q));
+
+  top = q->root;
+  q->root = merge_pairs (q, top->child);
+  q->size--;
+  return top;
+}
+
+/* Removes E, which must be in Q, from Q. */
+void
+pqueue_remove (struct pqueue *q, struct pqueue_elem *e)
+{
+  ASSERT (!pqueue_empty (q));
+
+  if (e == q->root)
+    {
+      pqueue_pop (q);
+      return;
+    }
+
+  /* Unlink E and its subtree from its parent or sibling. */
+  if (e->prev->child == e)
+    e->prev->child = e->next;
+  else
+    e->prev->next = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+
+  /* Put E's children back into the queue. */
+  q->root = meld (q, q->root, merge_pairs (q, e->child));
+  q->size--;
+}
+
+/* Returns the number of elements in Q. */
+size_t
+pqueue_size (struct pqueue *q)
+{
+  return q->size;
+}
+
+/* Returns true if Q is empty, false otherwise. */
+bool
+pqueue_empty (struct pqueue *q)
+{
+  return q->root == NULL;
+}
+
+/* Returns true if A should be popped before B in Q: A is
+   greater, or they are equal and A was pushed first. */
+static bool
+higher (struct pqueue *q, const struct pqueue_elem *a,
+        const struct pqueue_elem *b)
+{
+  if (q->less (b, a, q->aux))
+    return true;
+  if (q->less (a, b, q->aux))
+    return false;
+  return (int) (a->seq - b->seq) < 0;
+}
+
+/* Melds heaps rooted at A and B, either of which may be null,
+   and returns the new root. */
+static struct pqueue_elem *
+meld (struct pqueue *q, struct pqueue_elem *a, struct pqueue_elem *b)
+{
+  struct pqueue_elem *t;
+
+  if (a == NULL)
+    return b;
+  if (b == NULL)
+    return a;
+  if (higher (q, b, a))
+    {
+      t = a;
+      a = b;
+      b = t;
+    }
+
+  /* B becomes leftmost child of A. */
+  b->prev = a;
+  b->next = a->child;
+  if (a->child != NULL)
+    a->child->prev = b;
+  a->child = b;
+  a->next = a->prev = NULL;
+  return a;
+}
+
+/* Melds the list of siblings starting at FIRST into one heap
+   with the standard two-pass pairing, and returns its root. */
+static struct pqueue_elem *
+merge_pairs (struct pqueue *q, struct pqueue_elem *first)
+{
+  struct pqueue_elem *stack = NULL;
+  struct pqueue_elem *root = NULL;
+
+  /* Left to right, meld pairs and push them on a stack. */
+  while (first != NULL)
+    {
+      struct pqueue_elem *a = first;
+      struct pqueue_elem *b = a->next;
+
+      first = b != NULL ? b->next : NULL;
+      a->next = a->prev = NULL;
+      if (b != NULL)
+        b->next = b->prev = NULL;
+      a = meld (q, a, b);
+      a->next = stack;
+      stack = a;
+    }
+
+  /* Right to left, meld the pairs into one heap. */
+  while (stack != NULL)
+    {
+      struct pqueue_elem *a = stack;
+      stack = a->next;
+      a->next = NULL;
+      root = meld (q, root, a);
+    }
+  return root;
+}
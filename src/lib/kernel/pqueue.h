@@ -0,0 +1,66 @@
+#ifndef __LIB_KERNEL_PQUEUE_H
+#define __LIB_KERNEL_PQUEUE_H
+
+/* Priority queue.
+
+   This is a pairing heap.  Like struct list, it does not require
+   dynamically allocated memory: each structure that is a
+   potential queue element must embed a struct pqueue_elem
+   member, and the pqueue_entry macro converts a struct
+   pqueue_elem back to the structure that contains it.
+
+   The queue is ordered by a "less" function given at
+   initialization.  pqueue_pop() returns the greatest element,
+   and among equal elements the one pushed first, so a queue of
+   equal elements behaves as a FIFO.
+
+   pqueue_push() is O(1), and pqueue_pop() and pqueue_remove()
+   are O(lg n) amortized. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Priority queue element. */
+struct pqueue_elem
+  {
+    struct pqueue_elem *child;  /* Leftmost child. */
+    struct pqueue_elem *next;   /* Next sibling. */
+    struct pqueue_elem *prev;   /* Previous sibling, or parent if leftmost. */
+    unsigned seq;               /* Push order, for ties. */
+  };
+
+/* Converts pointer to priority queue element PQUEUE_ELEM into a
+   pointer to the structure that PQUEUE_ELEM is embedded inside.
+   Supply the name of the outer structure STRUCT and the member
+   name MEMBER of the queue element. */
+#define pqueue_entry(PQUEUE_ELEM, STRUCT, MEMBER)           \
+        ((STRUCT *) ((uint8_t *) &(PQUEUE_ELEM)->seq        \
+                     - offsetof (STRUCT, MEMBER.seq)))
+
+/* Compares the value of two priority queue elements A and B,
+   given auxiliary data AUX.  Returns true if A is less than B,
+   or false if A is greater than or equal to B. */
+typedef bool pqueue_less_func (const struct pqueue_elem *a,
+                               const struct pqueue_elem *b,
+                               void *aux);
+
+/* Priority queue. */
+struct pqueue
+  {
+    struct pqueue_elem *root;   /* Greatest element. */
+    size_t size;                /* Number of elements. */
+    unsigned seq;               /* Next push order. */
+    pqueue_less_func *less;     /* Comparison function. */
+    void *aux;                  /* Auxiliary data for `less'. */
+  };
+
+void pqueue_init (struct pqueue *, pqueue_less_func *, void *aux);
+void pqueue_push (struct pqueue *, struct pqueue_elem *);
+struct pqueue_elem *pqueue_top (struct pqueue *);
+struct pqueue_elem *pqueue_pop (struct pqueue *);
+void pqueue_remove (struct pqueue *, struct pqueue_elem *);
+size_t pqueue_size (struct pqueue *);
+bool pqueue_empty (struct pqueue *);
+
+#endif /* lib/kernel/pqueue.h */
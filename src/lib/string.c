@@ -1,5 +1,14 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block routines below move 32-bit words with the x86
+   string instructions once a block is at least this many bytes
+   long.  Shorter blocks are not worth the setup. */
+#define WORD_THRESHOLD 16
+
+/* Number of bytes needed to advance P to a word boundary. */
+#define WORD_HEAD(P) (-(uintptr_t) (P) & (sizeof (uint32_t) - 1))
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,6 +21,23 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD) 
+    {
+      /* Align the destination, then copy words.  Unaligned
+         loads from SRC are fine on x86. */
+      size_t head = WORD_HEAD (dst);
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = *src++;
+
+      words = size / sizeof (uint32_t);
+      size %= sizeof (uint32_t);
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
+
   while (size-- > 0)
     *dst++ = *src++;
 
@@ -29,20 +55,43 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst <= src || dst >= src + size) 
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* A forward copy never overwrites source bytes before
+         reading them. */
+      return memcpy (dst_, src_, size);
     }
-  else 
+
+  dst += size;
+  src += size;
+  if (size >= WORD_THRESHOLD) 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
+      /* Copy backward: align the end of the destination, then
+         copy words with the direction flag set. */
+      size_t tail = (uintptr_t) dst & (sizeof (uint32_t) - 1);
+      size_t words;
+
+      size -= tail;
+      while (tail-- > 0)
         *--dst = *--src;
+
+      words = size / sizeof (uint32_t);
+      size %= sizeof (uint32_t);
+      dst -= words * sizeof (uint32_t);
+      src -= words * sizeof (uint32_t);
+      if (words > 0) 
+        {
+          unsigned char *d = dst + (words - 1) * sizeof (uint32_t);
+          const unsigned char *s = src + (words - 1) * sizeof (uint32_t);
+          asm volatile ("std; rep movsl; cld"
+                        : "+D" (d), "+S" (s), "+c" (words) : : "memory");
+        }
     }
 
-  return dst;
+  while (size-- > 0)
+    *--dst = *--src;
+
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +107,24 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  if (size >= WORD_THRESHOLD) 
+    {
+      /* Skip over equal words.  The first unequal word, if any,
+         is left for the byte loop to order. */
+      size_t head = WORD_HEAD (a);
+
+      for (; head > 0; head--, size--, a++, b++)
+        if (*a != *b)
+          return *a > *b ? +1 : -1;
+      for (; size >= sizeof (uint32_t); size -= sizeof (uint32_t))
+        {
+          if (*(const uint32_t *) a != *(const uint32_t *) b)
+            break;
+          a += sizeof (uint32_t);
+          b += sizeof (uint32_t);
+        }
+    }
+
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,6 +348,22 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
+
+  if (size >= WORD_THRESHOLD) 
+    {
+      size_t head = WORD_HEAD (dst);
+      uint32_t word = (unsigned char) value * 0x01010101u;
+      size_t words;
+
+      size -= head;
+      while (head-- > 0)
+        *dst++ = value;
+
+      words = size / sizeof (uint32_t);
+      size %= sizeof (uint32_t);
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (word) : "memory");
+    }
   
   while (size-- > 0)
     *dst++ = value;
@@ -1,31 +1,84 @@
 #include <syscall.h>
 #include "../syscall-nr.h"
 
+/* System calls trap into the kernel with SYSENTER if the CPU
+   supports it, in which case the kernel has enabled it, and
+   with `int $0x30' otherwise.  For SYSENTER the stack pointer is
+   passed in %ecx and the return address in %edx, and both are
+   clobbered, and EFLAGS come back with only IF set.  Either
+   way the kernel finds the system call number and arguments on
+   the user stack. */
+#define SYSCALL_TRAP "int $0x30"
+#define SYSCALL_SYSENTER "movl %%esp, %%ecx; movl $1f, %%edx; sysenter; 1:"
+
+/* Returns true if SYSENTER can be used for system calls. */
+static bool
+sysenter_supported (void)
+{
+  /* 1 or 0 once known, -1 before. */
+  static int supported = -1;
+
+  if (supported < 0)
+    {
+      unsigned eax = 1, ebx, ecx, edx;
+      unsigned family, model, stepping;
+
+      /* Same check as the kernel's in userprog/gdt.c. */
+      asm volatile ("cpuid"
+                    : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+      family = (eax >> 8) & 0xf;
+      model = (eax >> 4) & 0xf;
+      stepping = eax & 0xf;
+      supported = (edx & 0x800) != 0
+                  && !(family == 6 && model < 3 && stepping < 3);
+    }
+  return supported;
+}
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
 #define syscall0(NUMBER)                                        \
         ({                                                      \
           int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
+          if (sysenter_supported ())                            \
+            asm volatile                                        \
+              ("pushl %[number]; " SYSCALL_SYSENTER             \
+               " addl $4, %%esp"                                \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER)                        \
+                 : "ecx", "edx", "memory");                     \
+          else                                                  \
+            asm volatile                                        \
+              ("pushl %[number]; " SYSCALL_TRAP                 \
+               "; addl $4, %%esp"                               \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER)                        \
+                 : "memory");                                   \
           retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
+#define syscall1(NUMBER, ARG0)                                  \
+        ({                                                      \
+          int retval;                                           \
+          if (sysenter_supported ())                            \
+            asm volatile                                        \
+              ("pushl %[arg0]; pushl %[number]; "               \
+               SYSCALL_SYSENTER " addl $8, %%esp"               \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0)                            \
+                 : "ecx", "edx", "memory");                     \
+          else                                                  \
+            asm volatile                                        \
+              ("pushl %[arg0]; pushl %[number]; "               \
+               SYSCALL_TRAP "; addl $8, %%esp"                  \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0)                            \
+                 : "memory");                                   \
+          retval;                                               \
         })
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
@@ -33,14 +86,26 @@
 #define syscall2(NUMBER, ARG0, ARG1)                            \
         ({                                                      \
           int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "g" (ARG0),                             \
-                 [arg1] "g" (ARG1)                              \
-               : "memory");                                     \
+          if (sysenter_supported ())                            \
+            asm volatile                                        \
+              ("pushl %[arg1]; pushl %[arg0]; "                 \
+               "pushl %[number]; " SYSCALL_SYSENTER             \
+               " addl $12, %%esp"                               \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0),                           \
+                   [arg1] "g" (ARG1)                            \
+                 : "ecx", "edx", "memory");                     \
+          else                                                  \
+            asm volatile                                        \
+              ("pushl %[arg1]; pushl %[arg0]; "                 \
+               "pushl %[number]; " SYSCALL_TRAP                 \
+               "; addl $12, %%esp"                              \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0),                           \
+                   [arg1] "g" (ARG1)                            \
+                 : "memory");                                   \
           retval;                                               \
         })
 
@@ -49,15 +114,60 @@
 #define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
         ({                                                      \
           int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "g" (ARG0),                             \
-                 [arg1] "g" (ARG1),                             \
-                 [arg2] "g" (ARG2)                              \
-               : "memory");                                     \
+          if (sysenter_supported ())                            \
+            asm volatile                                        \
+              ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "  \
+               "pushl %[number]; " SYSCALL_SYSENTER             \
+               " addl $16, %%esp"                               \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0),                           \
+                   [arg1] "g" (ARG1),                           \
+                   [arg2] "g" (ARG2)                            \
+                 : "ecx", "edx", "memory");                     \
+          else                                                  \
+            asm volatile                                        \
+              ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "  \
+               "pushl %[number]; " SYSCALL_TRAP                 \
+               "; addl $16, %%esp"                              \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0),                           \
+                   [arg1] "g" (ARG1),                           \
+                   [arg2] "g" (ARG2)                            \
+                 : "memory");                                   \
+          retval;                                               \
+        })
+
+/* Invokes syscall NUMBER, passing arguments ARG0, ARG1, ARG2,
+   and ARG3, and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                \
+        ({                                                      \
+          int retval;                                           \
+          if (sysenter_supported ())                            \
+            asm volatile                                        \
+              ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "  \
+               "pushl %[arg0]; pushl %[number]; "               \
+               SYSCALL_SYSENTER " addl $20, %%esp"              \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0),                           \
+                   [arg1] "g" (ARG1),                           \
+                   [arg2] "g" (ARG2),                           \
+                   [arg3] "g" (ARG3)                            \
+                 : "ecx", "edx", "memory");                     \
+          else                                                  \
+            asm volatile                                        \
+              ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; "  \
+               "pushl %[arg0]; pushl %[number]; "               \
+               SYSCALL_TRAP "; addl $20, %%esp"                 \
+                 : "=a" (retval)                                \
+                 : [number] "i" (NUMBER),                       \
+                   [arg0] "g" (ARG0),                           \
+                   [arg1] "g" (ARG1),                           \
+                   [arg2] "g" (ARG2),                           \
+                   [arg3] "g" (ARG3)                            \
+                 : "memory");                                   \
           retval;                                               \
         })
 
@@ -182,3 +292,45 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+int
+msync (mapid_t mapid, int flags)
+{
+  return syscall2 (SYS_MSYNC, mapid, flags);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, unsigned offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+copy_file_range (int fd_in, int fd_out, unsigned length)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, fd_in, fd_out, length);
+}
@@ -0,0 +1,130 @@
+/* Test program for bitmap scanning in lib/kernel/bitmap.c.
+
+   Fills large bitmaps with random fragmentation, checks
+   bitmap_scan() and bitmap_scan_from() against a bit-by-bit
+   scan like the one bitmap_scan() used to do, and times both.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <bitmap.h>
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/test.h"
+
+/* Number of bits in the benchmark bitmaps: a 32 MB swap disk's
+   worth of sectors. */
+#define BIT_CNT 65536
+
+/* Number of scans timed for each bitmap. */
+#define SCAN_CNT 64
+
+static void fill (struct bitmap *, int percent);
+static void verify (struct bitmap *);
+static void bench (struct bitmap *, int percent, size_t cnt);
+
+/* Test and time bitmap scanning. */
+void
+test (void)
+{
+  static const int percents[] = {50, 90, 99};
+  struct bitmap *b = bitmap_create (BIT_CNT);
+  size_t i;
+
+  ASSERT (b != NULL);
+  for (i = 0; i < sizeof percents / sizeof *percents; i++)
+    {
+      fill (b, percents[i]);
+      verify (b);
+      bench (b, percents[i], 1);
+      bench (b, percents[i], 8);
+    }
+  bitmap_destroy (b);
+}
+
+/* Sets each bit in B with probability PERCENT / 100. */
+static void
+fill (struct bitmap *b, int percent)
+{
+  size_t i;
+
+  for (i = 0; i < bitmap_size (b); i++)
+    bitmap_set (b, i, random_ulong () % 100 < (unsigned) percent);
+}
+
+/* The old bitmap_scan(): tries every starting position and tests
+   CNT bits from each. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt, bool value)
+{
+  size_t i, j;
+
+  if (cnt > bitmap_size (b))
+    return BITMAP_ERROR;
+  for (i = start; i <= bitmap_size (b) - cnt; i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j) != value)
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+/* Checks bitmap_scan() and bitmap_scan_from() against
+   slow_scan() from random positions in B. */
+static void
+verify (struct bitmap *b)
+{
+  int i;
+
+  for (i = 0; i < 256; i++)
+    {
+      size_t start = random_ulong () % (bitmap_size (b) + 1);
+      size_t cnt = random_ulong () % 12;
+      bool value = random_ulong () % 2;
+      size_t expect = slow_scan (b, start, cnt, value);
+
+      ASSERT (bitmap_scan (b, start, cnt, value) == expect);
+      if (expect == BITMAP_ERROR)
+        {
+          expect = slow_scan (b, 0, cnt, value);
+          if (expect >= start)
+            expect = BITMAP_ERROR;
+        }
+      ASSERT (bitmap_scan_from (b, start, cnt, value) == expect);
+    }
+}
+
+/* Times SCAN_CNT scans for CNT clear bits in B, starting at
+   random positions, with slow_scan() and bitmap_scan(), and
+   prints the average cycles per scan. */
+static void
+bench (struct bitmap *b, int percent, size_t cnt)
+{
+  size_t starts[SCAN_CNT];
+  uint64_t start, fast, slow;
+  int i;
+
+  for (i = 0; i < SCAN_CNT; i++)
+    starts[i] = random_ulong () % bitmap_size (b);
+
+  start = rdtsc ();
+  for (i = 0; i < SCAN_CNT; i++)
+    slow_scan (b, starts[i], cnt, false);
+  slow = (rdtsc () - start) / SCAN_CNT;
+
+  start = rdtsc ();
+  for (i = 0; i < SCAN_CNT; i++)
+    bitmap_scan (b, starts[i], cnt, false);
+  fast = (rdtsc () - start) / SCAN_CNT;
+
+  printf ("%d%% full, %zu bit runs: %llu cycles per scan, was %llu\n",
+          percent, cnt, fast, slow);
+}
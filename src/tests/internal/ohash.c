@@ -0,0 +1,157 @@
+/* Test program for lib/kernel/ohash.c.
+
+   Checks the open-addressed hash table against a plain array,
+   then times insertion, lookup and deletion of page-address keys
+   in it and in the chained hash table of lib/kernel/hash.c, set
+   up the way the supplemental page table uses it.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <hash.h>
+#include <ohash.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/cpu.h"
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Number of entries in each table. */
+#define ENTRY_CNT 4096
+
+/* An entry keyed by a user page address. */
+struct entry
+  {
+    void *vaddr;                /* Key. */
+    struct hash_elem elem;      /* Element in chained table. */
+  };
+
+static struct entry entries[ENTRY_CNT];
+
+static void verify (void);
+static void bench (size_t cnt);
+
+/* Test and time the open-addressed hash table. */
+void
+test (void)
+{
+  size_t i;
+
+  for (i = 0; i < ENTRY_CNT; i++)
+    entries[i].vaddr = (uint8_t *) 0x08048000 + i * PGSIZE;
+
+  verify ();
+  printf ("ohash agrees with array\n");
+
+  bench (64);
+  bench (512);
+  bench (ENTRY_CNT);
+}
+
+/* Checks random insertions, lookups and deletions in an ohash
+   against an array of which entries are present. */
+static void
+verify (void)
+{
+  static bool present[ENTRY_CNT];
+  struct ohash h;
+  size_t cnt = 0;
+  int i;
+
+  ohash_init (&h);
+  for (i = 0; i < 64 * ENTRY_CNT; i++)
+    {
+      size_t idx = random_ulong () % ENTRY_CNT;
+      struct entry *e = &entries[idx];
+
+      switch (random_ulong () % 3)
+        {
+        case 0:
+          ASSERT (ohash_insert (&h, e->vaddr, e) == !present[idx]);
+          if (!present[idx])
+            cnt++;
+          present[idx] = true;
+          break;
+
+        case 1:
+          ASSERT (ohash_find (&h, e->vaddr) == (present[idx] ? e : NULL));
+          break;
+
+        case 2:
+          ASSERT (ohash_delete (&h, e->vaddr) == (present[idx] ? e : NULL));
+          if (present[idx])
+            cnt--;
+          present[idx] = false;
+          break;
+        }
+      ASSERT (ohash_size (&h) == cnt);
+    }
+  ohash_destroy (&h, NULL);
+}
+
+/* Hashes an entry by its address, as vm/page.c does. */
+static unsigned
+entry_hash (const struct hash_elem *e_, void *aux UNUSED)
+{
+  const struct entry *e = hash_entry (e_, struct entry, elem);
+  return hash_bytes (&e->vaddr, sizeof e->vaddr);
+}
+
+/* Orders entries by address. */
+static bool
+entry_less (const struct hash_elem *a_, const struct hash_elem *b_,
+            void *aux UNUSED)
+{
+  const struct entry *a = hash_entry (a_, struct entry, elem);
+  const struct entry *b = hash_entry (b_, struct entry, elem);
+  return a->vaddr < b->vaddr;
+}
+
+/* Inserts CNT entries into each kind of table, looks each of
+   them up, then deletes them, and prints the average cycles per
+   operation. */
+static void
+bench (size_t cnt)
+{
+  uint64_t start, chain[3], open[3];
+  struct hash hash;
+  struct ohash ohash;
+  struct entry key;
+  size_t i;
+
+  ASSERT (cnt <= ENTRY_CNT);
+  if (!hash_init (&hash, entry_hash, entry_less, NULL))
+    PANIC ("out of memory");
+  ohash_init (&ohash);
+
+#define TIME(RESULT, STMT)                      \
+  start = rdtsc ();                             \
+  for (i = 0; i < cnt; i++)                     \
+    STMT;                                       \
+  RESULT = (rdtsc () - start) / cnt;
+
+  TIME (chain[0], hash_insert (&hash, &entries[i].elem));
+  TIME (chain[1], {
+      key.vaddr = entries[i].vaddr;
+      ASSERT (hash_find (&hash, &key.elem) != NULL);
+    });
+  TIME (chain[2], hash_delete (&hash, &entries[i].elem));
+
+  TIME (open[0], ohash_insert (&ohash, entries[i].vaddr, &entries[i]));
+  TIME (open[1], ASSERT (ohash_find (&ohash, entries[i].vaddr) != NULL));
+  TIME (open[2], ohash_delete (&ohash, entries[i].vaddr));
+#undef TIME
+
+  hash_destroy (&hash, NULL);
+  ohash_destroy (&ohash, NULL);
+
+  printf ("%4zu entries: cycles per op, chained vs. open addressing\n",
+          cnt);
+  printf ("  insert %5llu vs. %5llu\n", chain[0], open[0]);
+  printf ("  find   %5llu vs. %5llu\n", chain[1], open[1]);
+  printf ("  delete %5llu vs. %5llu\n", chain[2], open[2]);
+}
@@ -0,0 +1,201 @@
+/* Test program for the block functions in lib/string.c.
+
+   Checks memcpy(), memmove(), memset() and memcmp() against
+   simple byte-at-a-time versions for every combination of small
+   misalignments, then times both versions on the block sizes
+   the kernel uses most: a disk sector and a page.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <random.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/cpu.h"
+#include "threads/test.h"
+
+/* Largest block that we will test, plus slack for alignment. */
+#define MAX_SIZE 4096
+#define SLACK 8
+
+/* Number of times each timed call is repeated. */
+#define REPEAT 256
+
+static uint8_t buf_a[MAX_SIZE + 2 * SLACK];
+static uint8_t buf_b[MAX_SIZE + 2 * SLACK];
+static uint8_t buf_c[MAX_SIZE + 2 * SLACK];
+
+/* Keeps the compiler from discarding memcmp() results. */
+static volatile int sink;
+
+static void verify (void);
+static void bench (size_t size);
+
+/* Test and time the block functions. */
+void
+test (void)
+{
+  verify ();
+  printf ("block functions agree with byte loops\n");
+
+  bench (64);
+  bench (512);
+  bench (4096);
+}
+
+/* Byte-at-a-time memcpy(), as lib/string.c used to have. */
+static void *
+byte_memcpy (void *dst_, const void *src_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  while (size-- > 0)
+    *dst++ = *src++;
+  return dst_;
+}
+
+/* Byte-at-a-time memmove(). */
+static void *
+byte_memmove (void *dst_, const void *src_, size_t size)
+{
+  uint8_t *dst = dst_;
+  const uint8_t *src = src_;
+
+  if (dst < src)
+    while (size-- > 0)
+      *dst++ = *src++;
+  else
+    {
+      dst += size;
+      src += size;
+      while (size-- > 0)
+        *--dst = *--src;
+    }
+  return dst_;
+}
+
+/* Byte-at-a-time memset(). */
+static void *
+byte_memset (void *dst_, int value, size_t size)
+{
+  uint8_t *dst = dst_;
+
+  while (size-- > 0)
+    *dst++ = value;
+  return dst_;
+}
+
+/* Byte-at-a-time memcmp(). */
+static int
+byte_memcmp (const void *a_, const void *b_, size_t size)
+{
+  const uint8_t *a = a_;
+  const uint8_t *b = b_;
+
+  for (; size-- > 0; a++, b++)
+    if (*a != *b)
+      return *a > *b ? +1 : -1;
+  return 0;
+}
+
+/* Returns -1, 0 or +1 according to the sign of X. */
+static int
+sign (int x)
+{
+  return (x > 0) - (x < 0);
+}
+
+/* Fills the test buffers with random bytes, and makes buf_c a
+   copy of buf_a. */
+static void
+fill (void)
+{
+  random_bytes (buf_a, sizeof buf_a);
+  random_bytes (buf_b, sizeof buf_b);
+  memcpy (buf_c, buf_a, sizeof buf_a);
+}
+
+/* Checks each block function against its byte loop for sizes
+   around the word-copy threshold and for every alignment of
+   source and destination. */
+static void
+verify (void)
+{
+  static const size_t sizes[] = {0, 1, 3, 4, 7, 15, 16, 17, 31, 64, 65,
+                                 511, 512, 4095, MAX_SIZE};
+  size_t i;
+  int s, d;
+
+  for (i = 0; i < sizeof sizes / sizeof *sizes; i++)
+    for (s = 0; s < SLACK; s++)
+      for (d = 0; d < SLACK; d++)
+        {
+          size_t size = sizes[i];
+
+          fill ();
+          ASSERT (memcpy (buf_a + d, buf_b + s, size) == buf_a + d);
+          byte_memcpy (buf_c + d, buf_b + s, size);
+          ASSERT (!byte_memcmp (buf_a, buf_c, sizeof buf_a));
+
+          ASSERT (memset (buf_a + d, s * 37, size) == buf_a + d);
+          byte_memset (buf_c + d, s * 37, size);
+          ASSERT (!byte_memcmp (buf_a, buf_c, sizeof buf_a));
+
+          /* Overlapping moves, in both directions. */
+          ASSERT (memmove (buf_a + d, buf_a + s, size) == buf_a + d);
+          byte_memmove (buf_c + d, buf_c + s, size);
+          ASSERT (!byte_memcmp (buf_a, buf_c, sizeof buf_a));
+
+          ASSERT (sign (memcmp (buf_a + d, buf_b + s, size))
+                  == byte_memcmp (buf_a + d, buf_b + s, size));
+          if (size > 0)
+            {
+              memcpy (buf_a + d, buf_b + s, size);
+              ASSERT (memcmp (buf_a + d, buf_b + s, size) == 0);
+              buf_a[d + size - 1] ^= 1;
+              ASSERT (sign (memcmp (buf_a + d, buf_b + s, size))
+                      == byte_memcmp (buf_a + d, buf_b + s, size));
+            }
+        }
+}
+
+/* Times REPEAT calls of memcpy(), memmove(), memset() and
+   memcmp() on SIZE-byte blocks against their byte loops, and
+   prints the average cycles per call. */
+static void
+bench (size_t size)
+{
+  uint64_t start, fast[4], slow[4];
+  int i;
+
+  ASSERT (size <= MAX_SIZE);
+  fill ();
+
+#define TIME(RESULT, CALL)                      \
+  start = rdtsc ();                             \
+  for (i = 0; i < REPEAT; i++)                  \
+    CALL;                                       \
+  RESULT = (rdtsc () - start) / REPEAT;
+
+  TIME (fast[0], memcpy (buf_a, buf_b, size));
+  TIME (slow[0], byte_memcpy (buf_a, buf_b, size));
+  TIME (fast[1], memmove (buf_a + 1, buf_a, size));
+  TIME (slow[1], byte_memmove (buf_a + 1, buf_a, size));
+  TIME (fast[2], memset (buf_a, 0, size));
+  TIME (slow[2], byte_memset (buf_a, 0, size));
+  memcpy (buf_c, buf_a, size);
+  TIME (fast[3], sink += memcmp (buf_a, buf_c, size));
+  TIME (slow[3], sink += byte_memcmp (buf_a, buf_c, size));
+#undef TIME
+
+  printf ("%4zu bytes: cycles per call, word vs. byte loop\n", size);
+  printf ("  memcpy %6llu vs. %6llu\n", fast[0], slow[0]);
+  printf ("  memmove %5llu vs. %6llu\n", fast[1], slow[1]);
+  printf ("  memset %6llu vs. %6llu\n", fast[2], slow[2]);
+  printf ("  memcmp %6llu vs. %6llu\n", fast[3], slow[3]);
+}
@@ -0,0 +1,44 @@
+/* Copies a file with copy_file_range, then copies part of it
+   again at other offsets, and verifies the copies and the file
+   positions of both files. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int size = sizeof sample - 1;
+  char expected[sizeof sample];
+  int in, out;
+
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy.txt", 0), "create \"copy.txt\"");
+  CHECK ((out = open ("copy.txt")) > 1, "open \"copy.txt\"");
+
+  /* Copy whole file. */
+  CHECK (copy_file_range (in, out, size) == size,
+         "copy \"sample.txt\" to \"copy.txt\"");
+  CHECK ((int) tell (in) == size && (int) tell (out) == size,
+         "tell both files after copy");
+  CHECK (copy_file_range (in, out, 10) == 0,
+         "copy at end of \"sample.txt\" (must return 0)");
+  close (out);
+  check_file ("copy.txt", sample, size);
+
+  /* Copy part of file over other offsets. */
+  CHECK ((out = open ("copy.txt")) > 1, "open \"copy.txt\"");
+  seek (in, 100);
+  seek (out, 10);
+  CHECK (copy_file_range (in, out, 50) == 50,
+         "copy 50 bytes at offset 100 to offset 10");
+  CHECK (tell (in) == 150 && tell (out) == 60, "tell both files after copy");
+  close (out);
+  close (in);
+  memcpy (expected, sample, size);
+  memcpy (expected + 10, sample + 100, 50);
+  check_file ("copy.txt", expected, size);
+}
@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-file-range) begin
+(copy-file-range) open "sample.txt"
+(copy-file-range) create "copy.txt"
+(copy-file-range) open "copy.txt"
+(copy-file-range) copy "sample.txt" to "copy.txt"
+(copy-file-range) tell both files after copy
+(copy-file-range) copy at end of "sample.txt" (must return 0)
+(copy-file-range) open "copy.txt" for verification
+(copy-file-range) verified contents of "copy.txt"
+(copy-file-range) close "copy.txt"
+(copy-file-range) open "copy.txt"
+(copy-file-range) copy 50 bytes at offset 100 to offset 10
+(copy-file-range) tell both files after copy
+(copy-file-range) open "copy.txt" for verification
+(copy-file-range) verified contents of "copy.txt"
+(copy-file-range) close "copy.txt"
+(copy-file-range) end
+copy-file-range: exit(0)
+EOF
+pass;
@@ -0,0 +1,39 @@
+/* Reads and writes a file at given offsets with pread and
+   pwrite, and verifies that neither moves the file position. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int size = sizeof sample - 1;
+  char buf[100];
+  int handle;
+
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  seek (handle, 10);
+
+  CHECK (pread (handle, buf, 50, 100) == 50,
+         "pread 50 bytes at offset 100");
+  CHECK (!memcmp (buf, sample + 100, 50), "compare pread data");
+  CHECK (tell (handle) == 10, "tell \"sample.txt\" after pread");
+
+  CHECK (pwrite (handle, "pintos", 6, 200) == 6,
+         "pwrite 6 bytes at offset 200");
+  memcpy (sample + 200, "pintos", 6);
+  CHECK (tell (handle) == 10, "tell \"sample.txt\" after pwrite");
+
+  CHECK (pread (handle, buf, sizeof buf, size - 20) == 20,
+         "pread past end of \"sample.txt\"");
+  CHECK (!memcmp (buf, sample + size - 20, 20), "compare pread data");
+  CHECK (pread (handle, buf, 10, 0x80000000) == -1,
+         "pread at offset 0x80000000 (must return -1)");
+  CHECK (tell (handle) == 10, "tell \"sample.txt\" after pread");
+  close (handle);
+
+  check_file ("sample.txt", sample, size);
+}
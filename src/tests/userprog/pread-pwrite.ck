@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) pread 50 bytes at offset 100
+(pread-pwrite) compare pread data
+(pread-pwrite) tell "sample.txt" after pread
+(pread-pwrite) pwrite 6 bytes at offset 200
+(pread-pwrite) tell "sample.txt" after pwrite
+(pread-pwrite) pread past end of "sample.txt"
+(pread-pwrite) compare pread data
+(pread-pwrite) pread at offset 0x80000000 (must return -1)
+(pread-pwrite) tell "sample.txt" after pread
+(pread-pwrite) open "sample.txt" for verification
+(pread-pwrite) verified contents of "sample.txt"
+(pread-pwrite) close "sample.txt"
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
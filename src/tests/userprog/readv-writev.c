@@ -0,0 +1,48 @@
+/* Writes a file from several buffers with writev, including an
+   empty one, and reads it back into differently split buffers
+   with readv.  Also checks that readv stops at end of file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void)
+{
+  int size = sizeof sample - 1;
+  char buf[sizeof sample];
+  struct iovec out[3], in[3];
+  int handle;
+
+  CHECK (create ("test.txt", size), "create \"test.txt\"");
+  CHECK ((handle = open ("test.txt")) > 1, "open \"test.txt\"");
+
+  out[0].iov_base = sample;
+  out[0].iov_len = 10;
+  out[1].iov_base = sample + 10;
+  out[1].iov_len = 0;
+  out[2].iov_base = sample + 10;
+  out[2].iov_len = size - 10;
+  CHECK (writev (handle, out, 3) == size, "writev \"test.txt\"");
+  CHECK ((int) tell (handle) == size, "tell \"test.txt\" after writev");
+
+  seek (handle, 0);
+  memset (buf, 0, sizeof buf);
+  in[0].iov_base = buf;
+  in[0].iov_len = 100;
+  in[1].iov_base = buf + 100;
+  in[1].iov_len = 1;
+  in[2].iov_base = buf + 101;
+  in[2].iov_len = size - 101;
+  CHECK (readv (handle, in, 3) == size, "readv \"test.txt\"");
+  CHECK (!memcmp (buf, sample, size),
+         "compare read data against written data");
+
+  seek (handle, size - 5);
+  in[0].iov_len = 3;
+  in[1].iov_len = 10;
+  CHECK (readv (handle, in, 2) == 5, "readv past end of \"test.txt\"");
+  close (handle);
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "test.txt"
+(readv-writev) open "test.txt"
+(readv-writev) writev "test.txt"
+(readv-writev) tell "test.txt" after writev
+(readv-writev) readv "test.txt"
+(readv-writev) compare read data against written data
+(readv-writev) readv past end of "test.txt"
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
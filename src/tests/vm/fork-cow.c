@@ -0,0 +1,70 @@
+/* Forks a child that overwrites data and stack pages it shares
+   copy-on-write with its parent, and verifies that the parent's
+   copies are unchanged.  Then the parent writes its pages and
+   forks again, to verify that the new child sees the parent's
+   new data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char data[4096 * 2];
+
+/* Returns true if all SIZE bytes of BUF equal C. */
+static bool
+is_filled (const char *buf, char c, size_t size)
+{
+  size_t i;
+
+  for (i = 0; i < size; i++)
+    if (buf[i] != c)
+      return false;
+  return true;
+}
+
+void
+test_main (void)
+{
+  char stack[1024];
+  pid_t child;
+
+  memset (data, 'p', sizeof data);
+  memset (stack, 'p', sizeof stack);
+
+  /* Child writes its copies. */
+  msg ("fork");
+  child = fork ();
+  if (child == 0)
+    {
+      if (!is_filled (data, 'p', sizeof data)
+          || !is_filled (stack, 'p', sizeof stack))
+        fail ("child does not see parent's data");
+      memset (data, 'c', sizeof data);
+      memset (stack, 'c', sizeof stack);
+      exit (81);
+    }
+  else if (child == -1)
+    fail ("fork");
+  msg ("wait(fork()) = %d", wait (child));
+  CHECK (is_filled (data, 'p', sizeof data),
+         "parent's data pages unchanged");
+  CHECK (is_filled (stack, 'p', sizeof stack),
+         "parent's stack page unchanged");
+
+  /* Parent writes its copies, child checks them. */
+  memset (data, 'q', sizeof data);
+  memset (stack, 'q', sizeof stack);
+  msg ("fork again");
+  child = fork ();
+  if (child == 0)
+    {
+      if (!is_filled (data, 'q', sizeof data)
+          || !is_filled (stack, 'q', sizeof stack))
+        fail ("child does not see parent's new data");
+      exit (82);
+    }
+  else if (child == -1)
+    fail ("fork");
+  msg ("wait(fork()) = %d", wait (child));
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(fork-cow) begin
+(fork-cow) fork
+fork-cow: exit(81)
+(fork-cow) wait(fork()) = 81
+(fork-cow) parent's data pages unchanged
+(fork-cow) parent's stack page unchanged
+(fork-cow) fork again
+fork-cow: exit(82)
+(fork-cow) wait(fork()) = 82
+(fork-cow) end
+fork-cow: exit(0)
+EOF
+pass;
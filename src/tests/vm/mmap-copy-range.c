@@ -0,0 +1,53 @@
+/* Changes a mapped file in memory and copies it with
+   copy_file_range, to verify that the copy sees the mapping's
+   data.  Then copies the file into another mapped file, to
+   verify that the mapping sees the copied data. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SRC ((char *) 0x10000000)
+#define DST ((char *) 0x20000000)
+
+void
+test_main (void)
+{
+  int size = strlen (sample);
+  static char expected[sizeof sample];
+  int in, out;
+  mapid_t src_map, dst_map;
+
+  /* Change source through its mapping only. */
+  CHECK ((in = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((src_map = mmap (in, SRC)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memset (SRC, 'x', 100);
+  memcpy (expected, sample, size);
+  memset (expected, 'x', 100);
+
+  /* Copy mapped source into plain file. */
+  CHECK (create ("copy.txt", 0), "create \"copy.txt\"");
+  CHECK ((out = open ("copy.txt")) > 1, "open \"copy.txt\"");
+  CHECK (copy_file_range (in, out, size) == size,
+         "copy \"sample.txt\" to \"copy.txt\"");
+  close (out);
+  check_file ("copy.txt", expected, size);
+
+  /* Copy mapped source into mapped destination. */
+  CHECK (create ("dst.txt", size), "create \"dst.txt\"");
+  CHECK ((out = open ("dst.txt")) > 1, "open \"dst.txt\"");
+  CHECK ((dst_map = mmap (out, DST)) != MAP_FAILED, "mmap \"dst.txt\"");
+  seek (in, 0);
+  CHECK (copy_file_range (in, out, size) == size,
+         "copy \"sample.txt\" to \"dst.txt\"");
+  CHECK (!memcmp (DST, expected, size),
+         "compare mapping of \"dst.txt\" against copied data");
+
+  munmap (dst_map);
+  munmap (src_map);
+  close (out);
+  close (in);
+  check_file ("dst.txt", expected, size);
+}
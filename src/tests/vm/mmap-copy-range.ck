@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-copy-range) begin
+(mmap-copy-range) open "sample.txt"
+(mmap-copy-range) mmap "sample.txt"
+(mmap-copy-range) create "copy.txt"
+(mmap-copy-range) open "copy.txt"
+(mmap-copy-range) copy "sample.txt" to "copy.txt"
+(mmap-copy-range) open "copy.txt" for verification
+(mmap-copy-range) verified contents of "copy.txt"
+(mmap-copy-range) close "copy.txt"
+(mmap-copy-range) create "dst.txt"
+(mmap-copy-range) open "dst.txt"
+(mmap-copy-range) mmap "dst.txt"
+(mmap-copy-range) copy "sample.txt" to "dst.txt"
+(mmap-copy-range) compare mapping of "dst.txt" against copied data
+(mmap-copy-range) open "dst.txt" for verification
+(mmap-copy-range) verified contents of "dst.txt"
+(mmap-copy-range) close "dst.txt"
+(mmap-copy-range) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Writes to a file through a mapping, synchronizes the mapping
+   with msync, and reads the data back with the read system call.
+   Then changes the mapping again, unmaps it, and verifies that
+   munmap wrote the change back to the file. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/vm/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define ACTUAL ((void *) 0x10000000)
+
+void
+test_main (void)
+{
+  size_t size = strlen (sample);
+  char buf[1024];
+  int handle;
+  mapid_t map;
+
+  /* Write file via mmap, then synchronize it. */
+  CHECK (create ("sample.txt", size), "create \"sample.txt\"");
+  CHECK ((handle = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK ((map = mmap (handle, ACTUAL)) != MAP_FAILED, "mmap \"sample.txt\"");
+  memcpy (ACTUAL, sample, size);
+  CHECK (msync (map, 0) == -1, "msync without flags (must return -1)");
+  CHECK (msync (map, MS_SYNC) == 0, "msync \"sample.txt\" with MS_SYNC");
+
+  /* Read back via read(). */
+  CHECK (read (handle, buf, size) == (int) size, "read \"sample.txt\"");
+  CHECK (!memcmp (buf, sample, size),
+         "compare read data against written data");
+
+  /* Change the mapping and let munmap write it back. */
+  memset (ACTUAL, 'x', 100);
+  memset (buf, 'x', 100);
+  CHECK (msync (map, MS_ASYNC) == 0, "msync \"sample.txt\" with MS_ASYNC");
+  munmap (map);
+  CHECK (msync (map, MS_SYNC) == -1, "msync after munmap (must return -1)");
+  close (handle);
+  check_file ("sample.txt", buf, size);
+}
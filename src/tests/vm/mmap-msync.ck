@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(mmap-msync) begin
+(mmap-msync) create "sample.txt"
+(mmap-msync) open "sample.txt"
+(mmap-msync) mmap "sample.txt"
+(mmap-msync) msync without flags (must return -1)
+(mmap-msync) msync "sample.txt" with MS_SYNC
+(mmap-msync) read "sample.txt"
+(mmap-msync) compare read data against written data
+(mmap-msync) msync "sample.txt" with MS_ASYNC
+(mmap-msync) msync after munmap (must return -1)
+(mmap-msync) open "sample.txt" for verification
+(mmap-msync) verified contents of "sample.txt"
+(mmap-msync) close "sample.txt"
+(mmap-msync) end
+EOF
+pass;
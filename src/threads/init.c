@@ -44,6 +44,12 @@ size_t ram_pages;
 /* Page directory with kernel mappings only. */
 uint32_t *base_page_dir;
 
+/* 4 MB pages (CR4.PSE) are supported and enabled? */
+bool large_pages;
+
+#define CPUID_PSE 0x00000008    /* CPUID.1:EDX, 4 MB pages supported. */
+#define CR4_PSE 0x00000010      /* Page Size Extensions enable. */
+
 #ifdef FILESYS
 /* -f: Format the file system? */
 static bool format_filesys;
@@ -191,6 +197,19 @@ paging_init (void)
      to/from Control Registers" and [IA32-v3a] 3.7.5 "Base Address
      of the Page Directory". */
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (base_page_dir)));
+
+  /* Enable 4 MB pages for large user regions, if CPUID reports
+     PSE support.  See [IA32-v3a] 3.7.3 "Mixing 4-KByte and
+     4-MByte Pages". */
+  uint32_t eax = 1, ebx, ecx, edx;
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  if (edx & CPUID_PSE)
+    {
+      uint32_t cr4;
+      asm volatile ("movl %%cr4, %0" : "=r" (cr4));
+      asm volatile ("movl %0, %%cr4" : : "r" (cr4 | CR4_PSE));
+      large_pages = true;
+    }
 }
 
 /* Breaks the kernel command line into words and returns them as
@@ -251,6 +270,8 @@ parse_options (char **argv)
         random_init (atoi (value));
       else if (!strcmp (name, "-mlfqs"))
         thread_mlfqs = true;
+      else if (!strcmp (name, "-tickless"))
+        timer_tickless = true;
 #ifdef USERPROG
       else if (!strcmp (name, "-ul"))
         user_page_limit = atoi (value);
@@ -356,6 +377,7 @@ usage (void)
           "  -f                 Format file system disk during startup.\n"
           "  -rs=SEED           Set random number seed to SEED.\n"
           "  -mlfqs             Use multi-level feedback queue scheduler.\n"
+          "  -tickless          Use one-shot timer, skip ticks while idle.\n"
 #ifdef USERPROG
           "  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -401,5 +423,6 @@ print_stats (void)
   kbd_print_stats ();
 #ifdef USERPROG
   exception_print_stats ();
+  syscall_print_stats ();
 #endif
 }
@@ -12,6 +12,9 @@ extern size_t ram_pages;
 /* Page directory with kernel mappings only. */
 extern uint32_t *base_page_dir;
 
+/* 4 MB pages (CR4.PSE) are supported and enabled? */
+extern bool large_pages;
+
 /* -q: Power off when kernel tasks complete? */
 extern bool power_off_when_done;
 
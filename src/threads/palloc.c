@@ -2,6 +2,7 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
@@ -9,7 +10,7 @@
 #include <string.h>
 #include "threads/init.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
+#include "threads/interrupt.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
@@ -24,14 +25,51 @@
 
    By default, half of system RAM is given to the kernel pool and
    half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   kernel pool, but that's just fine for demonstration purposes.
+
+   Within a pool, free pages are managed by a binary buddy
+   allocator.  A block of order K is 2**K pages aligned to 2**K
+   pages, and each order has a list of free blocks, linked through
+   the blocks' first page.  An allocation takes a block of the
+   smallest sufficient order, splitting a larger block if needed,
+   and gives pages beyond the request back.  Freeing a block merges
+   it with its buddy as long as the buddy is free, so both take
+   O(log n) time.  Block alignment is relative to a page number
+   that is a multiple of the largest block size, so blocks are
+   also aligned in memory, e.g. for 4 MB pages.  The pool's bitmap
+   of used pages is only kept for consistency checking.
+
+   Single pages, which most allocations are, bypass the buddy
+   allocator where possible.  Each pool keeps a LIFO list of
+   recently freed pages, likely still in CPU cache, and a list of
+   pages zeroed by the idle thread, so that palloc_get_page() is
+   usually just a pop.  Pages in these lists are handed back to
+   the buddy allocator when it runs out of memory. */
+
+/* Max number of recently freed and of pre-zeroed pages per pool. */
+#define PALLOC_HOT_MAX 32
+#define PALLOC_ZERO_MAX 32
+
+/* Largest block order, 2**BUDDY_MAX_ORDER pages (64 MB). */
+#define BUDDY_MAX_ORDER 14
+
+/* order_map entry of first page of a free block, OR'd with its
+   order.  Zero for other pages. */
+#define BUDDY_FREE 0x80
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct bitmap *used_map;            /* Bitmap of used pages. */
     uint8_t *base;                      /* Base of pool. */
+    size_t origin;                      /* Page number blocks align to. */
+    size_t first, end;                  /* Pool pages, relative to origin. */
+    uint8_t *order_map;                 /* Free block heads, from origin. */
+    struct list free_lists[BUDDY_MAX_ORDER + 1]; /* Free blocks by order. */
+    struct list hot_list;               /* Recently freed pages. */
+    size_t hot_cnt;                     /* Number of pages in hot_list. */
+    struct list zero_list;              /* Zeroed free pages. */
+    size_t zero_cnt;                    /* Number of pages in zero_list. */
   };
 
 /* Two pools: one for kernel data, one for user pages. */
@@ -43,6 +81,12 @@ size_t user_page_limit = SIZE_MAX;
 static void init_pool (struct pool *, void *base, size_t page_cnt,
                        const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t buddy_alloc (struct pool *, int order);
+static void buddy_free (struct pool *, size_t idx, int order);
+static void buddy_free_range (struct pool *, size_t idx, size_t cnt);
+static struct list_elem *block_elem (struct pool *, size_t idx);
+static int buddy_order (size_t page_cnt);
+static bool pool_drain (struct pool *);
 
 /* Initializes the page allocator. */
 void
@@ -73,25 +117,40 @@ palloc_init (void)
    otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
    then the pages are filled with zeros.  If too few pages are
    available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   FLAGS, in which case the kernel panics.  If PAL_ALIGN is set,
+   PAGE_CNT must be a power of 2 and the pages are aligned to a
+   multiple of PAGE_CNT pages (e.g. for 4 MB pages). */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
   struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
-  size_t page_idx;
+  void *pages = NULL;
+  enum intr_level old_level;
+  size_t idx;
+  int order;
 
   if (page_cnt == 0)
     return NULL;
+  ASSERT (!(flags & PAL_ALIGN) || (page_cnt & (page_cnt - 1)) == 0);
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
+  /* Pools are also used while a thread exits, so they are
+     protected by disabling interrupts rather than by a lock. */
+  order = buddy_order (page_cnt);
+  old_level = intr_disable ();
+  idx = order <= BUDDY_MAX_ORDER ? buddy_alloc (pool, order) : BITMAP_ERROR;
+  if (idx == BITMAP_ERROR && order <= BUDDY_MAX_ORDER && pool_drain (pool))
+    idx = buddy_alloc (pool, order);
+  if (idx != BITMAP_ERROR)
+    {
+      /* Give back pages of block beyond PAGE_CNT. */
+      buddy_free_range (pool, idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+      pages = (uint8_t *) ((pool->origin + idx) << PGBITS);
+      ASSERT (bitmap_none (pool->used_map, pg_no (pages) - pg_no (pool->base),
+                           page_cnt));
+      bitmap_set_multiple (pool->used_map, pg_no (pages) - pg_no (pool->base),
+                           page_cnt, true);
+    }
+  intr_set_level (old_level);
 
   if (pages != NULL) 
     {
@@ -117,7 +176,87 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 void *
 palloc_get_page (enum palloc_flags flags) 
 {
-  return palloc_get_multiple (flags, 1);
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+  void *page = NULL;
+  bool zeroed = false;
+
+  old_level = intr_disable ();
+  if ((flags & PAL_ZERO) && pool->zero_cnt > 0)
+    {
+      page = list_pop_front (&pool->zero_list);
+      pool->zero_cnt--;
+      zeroed = true;
+    }
+  else if (pool->hot_cnt > 0)
+    {
+      page = list_pop_front (&pool->hot_list);
+      pool->hot_cnt--;
+    }
+  if (page != NULL)
+    {
+      size_t page_idx = pg_no (page) - pg_no (pool->base);
+      ASSERT (!bitmap_test (pool->used_map, page_idx));
+      bitmap_mark (pool->used_map, page_idx);
+    }
+  intr_set_level (old_level);
+
+  if (page == NULL)
+    return palloc_get_multiple (flags, 1);
+
+  /* Zeroed page is dirty only where its list element was. */
+  if (zeroed)
+    memset (page, 0, sizeof (struct list_elem));
+  else if (flags & PAL_ZERO)
+    memset (page, 0, PGSIZE);
+  return page;
+}
+
+/* Zeroes a free page for a later palloc_get_page(PAL_ZERO), if a
+   pool has room for one more.  Called by the idle thread with
+   interrupts on.  Returns true if a page was zeroed, false if
+   there was nothing to do. */
+bool
+palloc_zero_idle (void)
+{
+  struct pool *pools[] = {&kernel_pool, &user_pool};
+  enum intr_level old_level;
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++)
+    {
+      struct pool *pool = pools[i];
+      void *page = NULL;
+
+      old_level = intr_disable ();
+      if (pool->zero_cnt < PALLOC_ZERO_MAX)
+        {
+          if (pool->hot_cnt > 0)
+            {
+              page = list_pop_front (&pool->hot_list);
+              pool->hot_cnt--;
+            }
+          else
+            {
+              size_t idx = buddy_alloc (pool, 0);
+              if (idx != BITMAP_ERROR)
+                page = block_elem (pool, idx);
+            }
+        }
+      intr_set_level (old_level);
+      if (page == NULL)
+        continue;
+
+      /* Page is free but in no list, zero it with interrupts on. */
+      memset (page, 0, PGSIZE);
+
+      old_level = intr_disable ();
+      list_push_front (&pool->zero_list, page);
+      pool->zero_cnt++;
+      intr_set_level (old_level);
+      return true;
+    }
+  return false;
 }
 
 /* Frees the PAGE_CNT pages starting at PAGES. */
@@ -125,6 +264,7 @@ void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
   struct pool *pool;
+  enum intr_level old_level;
   size_t page_idx;
 
   ASSERT (pg_ofs (pages) == 0);
@@ -144,15 +284,50 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
+  old_level = intr_disable ();
   ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
   bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  buddy_free_range (pool, pg_no (pages) - pool->origin, page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
 void
 palloc_free_page (void *page) 
 {
-  palloc_free_multiple (page, 1);
+  struct pool *pool;
+  enum intr_level old_level;
+  size_t page_idx;
+
+  ASSERT (pg_ofs (page) == 0);
+  if (page == NULL)
+    return;
+
+  if (page_from_pool (&kernel_pool, page))
+    pool = &kernel_pool;
+  else if (page_from_pool (&user_pool, page))
+    pool = &user_pool;
+  else
+    NOT_REACHED ();
+
+  if (pool->hot_cnt >= PALLOC_HOT_MAX)
+    {
+      palloc_free_multiple (page, 1);
+      return;
+    }
+
+#ifndef NDEBUG
+  memset (page, 0xcc, PGSIZE);
+#endif
+
+  /* Keep it for next palloc_get_page(). */
+  page_idx = pg_no (page) - pg_no (pool->base);
+  old_level = intr_disable ();
+  ASSERT (bitmap_test (pool->used_map, page_idx));
+  bitmap_reset (pool->used_map, page_idx);
+  list_push_front (&pool->hot_list, page);
+  pool->hot_cnt++;
+  intr_set_level (old_level);
 }
 
 /* Initializes pool P as starting at START and ending at END,
@@ -160,10 +335,16 @@ palloc_free_page (void *page)
 static void
 init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
+  /* We'll put the pool's used_map and order_map at its base.
+     Calculate the space needed for them and subtract it from the
+     pool's size.  order_map covers pages from origin, which is at
+     most 2**BUDDY_MAX_ORDER pages before base. */
+  size_t origin = ROUND_DOWN (pg_no (base), (size_t) 1 << BUDDY_MAX_ORDER);
+  size_t map_size = pg_no (base) + page_cnt - origin;
+  size_t bm_size = ROUND_UP (bitmap_buf_size (page_cnt), sizeof (void *));
+  size_t bm_pages = DIV_ROUND_UP (bm_size + map_size, PGSIZE);
+  int order;
+
   if (bm_pages > page_cnt)
     PANIC ("Not enough memory in %s for bitmap.", name);
   page_cnt -= bm_pages;
@@ -171,9 +352,20 @@ init_pool (struct pool *p, void *base, size_t page_cnt, const char *name)
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_size);
+  p->order_map = (uint8_t *) base + bm_size;
+  memset (p->order_map, 0, map_size);
+  p->base = (uint8_t *) base + bm_pages * PGSIZE;
+  p->origin = origin;
+  p->first = pg_no (p->base) - origin;
+  p->end = p->first + page_cnt;
+  for (order = 0; order <= BUDDY_MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  list_init (&p->hot_list);
+  p->hot_cnt = 0;
+  list_init (&p->zero_list);
+  p->zero_cnt = 0;
+  buddy_free_range (p, p->first, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -187,3 +379,121 @@ page_from_pool (const struct pool *pool, void *page)
 
   return page_no >= start_page && page_no < end_page;
 }
+
+/* Returns first page of block IDX of POOL, where its free list
+   element is kept. */
+static struct list_elem *
+block_elem (struct pool *pool, size_t idx)
+{
+  return (struct list_elem *) ((pool->origin + idx) << PGBITS);
+}
+
+/* Gives pages of POOL's hot and zeroed lists back to buddy
+   allocator.  Returns true if there were any.  Interrupts must
+   be off. */
+static bool
+pool_drain (struct pool *pool)
+{
+  bool drained = pool->hot_cnt > 0 || pool->zero_cnt > 0;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  while (!list_empty (&pool->hot_list))
+    buddy_free (pool, pg_no (list_pop_front (&pool->hot_list)) - pool->origin,
+                0);
+  while (!list_empty (&pool->zero_list))
+    buddy_free (pool, pg_no (list_pop_front (&pool->zero_list)) - pool->origin,
+                0);
+  pool->hot_cnt = pool->zero_cnt = 0;
+  return drained;
+}
+
+/* Returns smallest order of block of at least PAGE_CNT pages. */
+static int
+buddy_order (size_t page_cnt)
+{
+  int order = 0;
+  while (((size_t) 1 << order) < page_cnt)
+    order++;
+  return order;
+}
+
+/* Takes a free block of ORDER from POOL, splitting a larger block
+   if there is none.  Returns index of its first page relative to
+   POOL's origin, or BITMAP_ERROR if no block is large enough.
+   Interrupts must be off. */
+static size_t
+buddy_alloc (struct pool *pool, int order)
+{
+  struct list_elem *e;
+  size_t idx;
+  int k;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (k = order; k <= BUDDY_MAX_ORDER; k++)
+    if (!list_empty (&pool->free_lists[k]))
+      break;
+  if (k > BUDDY_MAX_ORDER)
+    return BITMAP_ERROR;
+
+  e = list_pop_front (&pool->free_lists[k]);
+  idx = pg_no (e) - pool->origin;
+  ASSERT (pool->order_map[idx] == (BUDDY_FREE | k));
+  pool->order_map[idx] = 0;
+
+  /* Split, putting upper halves back. */
+  while (k > order)
+    {
+      size_t buddy;
+
+      k--;
+      buddy = idx + ((size_t) 1 << k);
+      pool->order_map[buddy] = BUDDY_FREE | k;
+      list_push_front (&pool->free_lists[k], block_elem (pool, buddy));
+    }
+  return idx;
+}
+
+/* Puts block IDX of ORDER back into POOL, merging it with its
+   buddy while the buddy is free.  Interrupts must be off. */
+static void
+buddy_free (struct pool *pool, size_t idx, int order)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (idx % ((size_t) 1 << order) == 0);
+
+  while (order < BUDDY_MAX_ORDER)
+    {
+      size_t buddy = idx ^ ((size_t) 1 << order);
+      if (buddy < pool->first
+          || buddy + ((size_t) 1 << order) > pool->end
+          || pool->order_map[buddy] != (BUDDY_FREE | order))
+        break;
+
+      list_remove (block_elem (pool, buddy));
+      pool->order_map[buddy] = 0;
+      idx &= ~((size_t) 1 << order);
+      order++;
+    }
+  pool->order_map[idx] = BUDDY_FREE | order;
+  list_push_front (&pool->free_lists[order], block_elem (pool, idx));
+}
+
+/* Puts CNT pages from IDX back into POOL, as the largest aligned
+   blocks that cover them.  Interrupts must be off. */
+static void
+buddy_free_range (struct pool *pool, size_t idx, size_t cnt)
+{
+  while (cnt > 0)
+    {
+      int order = 0;
+      while (order < BUDDY_MAX_ORDER
+             && idx % ((size_t) 2 << order) == 0
+             && ((size_t) 2 << order) <= cnt)
+        order++;
+      buddy_free (pool, idx, order);
+      idx += (size_t) 1 << order;
+      cnt -= (size_t) 1 << order;
+    }
+}
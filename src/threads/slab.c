@@ -0,0 +1,194 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator for frequently allocated kernel objects.
+
+   malloc() rounds every request up to a power of 2, so objects
+   such as supplemental page table entries or inodes waste up to
+   half of their block, and every call takes the descriptor's
+   lock.  A kmem_cache instead serves objects of one exact size.
+
+   Each slab is a page from the page allocator, with a slab header
+   at its beginning followed by as many objects as fit.  Free
+   objects in a slab are linked through their first word.  Slabs
+   with free objects are kept in the cache's partial list, and a
+   slab whose objects are all free is given back to the page
+   allocator.
+
+   In front of the slabs, each cache has a magazine of recently
+   freed objects.  Since there is a single CPU, the magazine is
+   protected by briefly turning interrupts off, so alloc and free
+   that hit the magazine do not take the lock. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free;                 /* First free object. */
+    struct list_elem elem;      /* Element in cache's partial list. */
+  };
+
+static void *slab_alloc (struct kmem_cache *);
+static void slab_free (struct kmem_cache *, void *);
+
+/* Creates and returns a cache of objects of SIZE bytes named NAME,
+   or a null pointer if memory is not available.  SIZE must leave
+   room for at least one object in a slab. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size)
+{
+  struct kmem_cache *c;
+
+  ASSERT (name != NULL);
+
+  /* Free objects hold a pointer, and keep objects word aligned. */
+  if (size < sizeof (void *))
+    size = sizeof (void *);
+  size = ROUND_UP (size, sizeof (void *));
+  ASSERT (size <= PGSIZE - sizeof (struct slab));
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+  c->name = name;
+  c->obj_size = size;
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / size;
+  list_init (&c->partial);
+  lock_init (&c->lock);
+  c->mag_cnt = 0;
+  return c;
+}
+
+/* Obtains and returns an object from cache C.  Returns a null
+   pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  enum intr_level old_level;
+  void *obj = NULL;
+
+  ASSERT (c != NULL);
+
+  /* Fast path, recently freed object. */
+  old_level = intr_disable ();
+  if (c->mag_cnt > 0)
+    obj = c->magazine[--c->mag_cnt];
+  intr_set_level (old_level);
+  if (obj != NULL)
+    return obj;
+
+  lock_acquire (&c->lock);
+  obj = slab_alloc (c);
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Frees object OBJ, which must have been allocated from cache C. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  enum intr_level old_level;
+  bool cached = false;
+
+  ASSERT (c != NULL);
+  if (obj == NULL)
+    return;
+  ASSERT (((struct slab *) pg_round_down (obj))->magic == SLAB_MAGIC);
+  ASSERT (((struct slab *) pg_round_down (obj))->cache == c);
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs. */
+  memset (obj, 0xcc, c->obj_size);
+#endif
+
+  /* Fast path, keep it in magazine. */
+  old_level = intr_disable ();
+  if (c->mag_cnt < KMEM_MAGAZINE_SIZE)
+    {
+      c->magazine[c->mag_cnt++] = obj;
+      cached = true;
+    }
+  intr_set_level (old_level);
+  if (cached)
+    return;
+
+  lock_acquire (&c->lock);
+  slab_free (c, obj);
+  lock_release (&c->lock);
+}
+
+/* Takes a free object from a partial slab of C, creating a new
+   slab if there is none.  C's lock must be held. */
+static void *
+slab_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  if (list_empty (&c->partial))
+    {
+      uint8_t *p;
+      size_t i;
+
+      s = palloc_get_page (0);
+      if (s == NULL)
+        return NULL;
+
+      /* Initialize slab and link all its objects. */
+      s->magic = SLAB_MAGIC;
+      s->cache = c;
+      s->free_cnt = c->objs_per_slab;
+      s->free = NULL;
+      p = (uint8_t *) (s + 1) + c->obj_size * c->objs_per_slab;
+      for (i = 0; i < c->objs_per_slab; i++)
+        {
+          p -= c->obj_size;
+          *(void **) p = s->free;
+          s->free = p;
+        }
+      list_push_front (&c->partial, &s->elem);
+    }
+
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+  obj = s->free;
+  s->free = *(void **) obj;
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+  return obj;
+}
+
+/* Puts OBJ back into its slab in C, freeing the slab once all of
+   its objects are free.  C's lock must be held. */
+static void
+slab_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+  ASSERT (((uint8_t *) obj - (uint8_t *) (s + 1)) % c->obj_size == 0);
+
+  *(void **) obj = s->free;
+  s->free = obj;
+  if (s->free_cnt++ == 0)
+    list_push_front (&c->partial, &s->elem);
+  if (s->free_cnt == c->objs_per_slab)
+    {
+      list_remove (&s->elem);
+      s->magic = 0;
+      palloc_free_page (s);
+    }
+}
@@ -0,0 +1,30 @@
+#ifndef THREADS_SLAB_H
+#define THREADS_SLAB_H
+
+#include <list.h>
+#include <stddef.h>
+#include "threads/synch.h"
+
+/* Number of recently freed objects kept in a cache's magazine. */
+#define KMEM_MAGAZINE_SIZE 16
+
+/* Cache of kernel objects of one exact size (see slab.c). */
+struct kmem_cache
+  {
+    const char *name;           /* Name (for debugging purposes). */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    struct list partial;        /* Slabs with free objects. */
+    struct lock lock;           /* Protects slabs. */
+
+    /* Recently freed objects, taken and put back with interrupts
+       off instead of the lock. */
+    void *magazine[KMEM_MAGAZINE_SIZE];
+    size_t mag_cnt;             /* Number of objects in magazine. */
+  };
+
+struct kmem_cache *kmem_cache_create (const char *name, size_t size);
+void *kmem_cache_alloc (struct kmem_cache *);
+void kmem_cache_free (struct kmem_cache *, void *);
+
+#endif /* threads/slab.h */
@@ -30,8 +30,13 @@
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
+#include "threads/malloc.h"
 #include "threads/thread.h"
 
+static bool sema_less_waiter (const struct pqueue_elem *,
+                              const struct pqueue_elem *, void *aux);
+static void sema_update_priority_max (struct semaphore *);
+
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
    manipulating it:
@@ -48,7 +53,7 @@ sema_init (struct semaphore *sema, unsigned value)
 
   sema->value = value;
   sema->priority_max = PRI_MIN;
-  list_init (&sema->waiters);
+  pqueue_init (&sema->waiters, sema_less_waiter, NULL);
 }
 
 /* Down or "P" operation on a semaphore.  Waits for SEMA's value
@@ -71,7 +76,9 @@ sema_down (struct semaphore *sema)
   while (sema->value == 0) 
     {
       old_level = intr_disable ();
-      list_push_back (&sema->waiters, &t->elem);
+      pqueue_push (&sema->waiters, &t->waitelem);
+      t->sema_waiting = sema;
+      sema_update_priority_max (sema);
       thread_block ();
       intr_set_level (old_level);
     }
@@ -112,23 +119,19 @@ void
 sema_up (struct semaphore *sema) 
 {
   enum intr_level old_level;
-  struct list_elem *e;
+  struct thread *t;
 
   ASSERT (sema != NULL);
 
   old_level = intr_disable ();
-  if (!list_empty (&sema->waiters))
+  if (!pqueue_empty (&sema->waiters))
     {
-      e = list_max (&sema->waiters, thread_less_priority, NULL);
-      list_remove (e);
-      thread_unblock (list_entry (e, struct thread, elem));
+      t = pqueue_entry (pqueue_pop (&sema->waiters), struct thread, waitelem);
+      t->sema_waiting = NULL;
+      thread_unblock (t);
     }
   /* Update semaphores's max priority */
-  if (!list_empty (&sema->waiters))
-    {
-      e = list_max (&sema->waiters, thread_less_priority, NULL);
-      sema->priority_max = list_entry (e, struct thread, elem)->priority;
-    }
+  sema_update_priority_max (sema);
   sema->value++;
   thread_check_yield ();
   intr_set_level (old_level);
@@ -171,13 +174,50 @@ sema_test_helper (void *sema_)
     }
 }
 
-/* Less function that compare semaphore's priority_max */
-bool sema_less_priority_max (const struct list_elem* e1,
-                             const struct list_elem* e2,
-                             void* AUX UNUSED)
+/* Moves thread T, waiting for SEMA, to its place for T's new
+   priority.  Interrupts must be turned off. */
+void
+sema_requeue (struct semaphore *sema, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->sema_waiting == sema);
+
+  pqueue_remove (&sema->waiters, &t->waitelem);
+  pqueue_push (&sema->waiters, &t->waitelem);
+  sema_update_priority_max (sema);
+}
+
+/* Sets SEMA's priority_max to the priority of its highest
+   priority waiter, or PRI_MIN if there is none. */
+static void
+sema_update_priority_max (struct semaphore *sema)
+{
+  if (pqueue_empty (&sema->waiters))
+    sema->priority_max = PRI_MIN;
+  else
+    sema->priority_max = pqueue_entry (pqueue_top (&sema->waiters),
+                                       struct thread, waitelem)->priority;
+}
+
+/* Less function that orders semaphore waiters by priority */
+static bool
+sema_less_waiter (const struct pqueue_elem *e1,
+                  const struct pqueue_elem *e2,
+                  void *aux UNUSED)
+{
+  const struct thread *t1 = pqueue_entry (e1, struct thread, waitelem);
+  const struct thread *t2 = pqueue_entry (e2, struct thread, waitelem);
+  return t1->priority < t2->priority;
+}
+
+/* Less function that compares lock's semaphore priority_max */
+bool
+lock_less_priority_max (const struct pqueue_elem *e1,
+                        const struct pqueue_elem *e2,
+                        void *aux UNUSED)
 {
-  struct semaphore *s1 = &list_entry (e1, struct lock, elem)->semaphore;
-  struct semaphore *s2 = &list_entry (e2, struct lock, elem)->semaphore;
+  struct semaphore *s1 = &pqueue_entry (e1, struct lock, elem)->semaphore;
+  struct semaphore *s2 = &pqueue_entry (e2, struct lock, elem)->semaphore;
   return s1->priority_max < s2->priority_max;
 }
 
@@ -219,25 +259,39 @@ void
 lock_acquire (struct lock *lock)
 {
   struct thread *t = thread_current ();
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
   
-  /* Check priority donations when thread_mlfqs is not set */
+  old_level = intr_disable ();
+  /* Check priority donations when thread_mlfqs is not set.
+     Donate again on every wait, since another thread may have
+     taken the lock in between. */
   if (!thread_mlfqs)
     {
-      t->lock_waiting = lock;
-      // thread_donate_priority ();
+      while (lock->semaphore.value == 0)
+        {
+          t->lock_waiting = lock;
+          t->sema_waiting = &lock->semaphore;
+          pqueue_push (&lock->semaphore.waiters, &t->waitelem);
+          sema_update_priority_max (&lock->semaphore);
+          thread_donate_priority ();
+          thread_block ();
+        }
+      t->lock_waiting = NULL;
     }
   sema_down (&lock->semaphore);
+  lock->holder = t;
 
-  /* Add lock into thread's locks list */
+  /* Add lock into thread's locks, remaining waiters donate to us */
   if (!thread_mlfqs)
     {
-      list_push_back (&t->locks, &lock->elem);
-      t->lock_waiting = NULL;
+      pqueue_push (&t->locks, &lock->elem);
+      thread_priority_update ();
     }
-  lock->holder = t;
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -249,14 +303,24 @@ lock_acquire (struct lock *lock)
 bool
 lock_try_acquire (struct lock *lock)
 {
+  enum intr_level old_level;
   bool success;
 
   ASSERT (lock != NULL);
   ASSERT (!lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      lock->holder = thread_current ();
+      if (!thread_mlfqs)
+        {
+          pqueue_push (&thread_current ()->locks, &lock->elem);
+          thread_priority_update ();
+        }
+    }
+  intr_set_level (old_level);
   return success;
 }
 
@@ -273,8 +337,12 @@ lock_release (struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   enum intr_level old_level = intr_disable ();
 
-//  if (!thread_mlfqs)
-//    thread_reset_donation (lock);
+  /* Drop donations through this lock */
+  if (!thread_mlfqs)
+    {
+      pqueue_remove (&lock->holder->locks, &lock->elem);
+      thread_priority_update ();
+    }
 
   lock->holder = NULL;
   sema_up (&lock->semaphore);
@@ -293,13 +361,17 @@ lock_held_by_current_thread (const struct lock *lock)
 }
 
 
-/* One semaphore in a list. */
+/* One semaphore in a condition's wait queue. */
 struct semaphore_elem 
   {
-    struct list_elem elem;              /* List element. */
+    struct pqueue_elem elem;            /* Priority queue element. */
     struct semaphore semaphore;         /* This semaphore. */
+    int priority;                       /* Priority of waiting thread. */
   };
 
+static bool cond_less_waiter (const struct pqueue_elem *,
+                              const struct pqueue_elem *, void *aux);
+
 /* Initializes condition variable COND.  A condition variable
    allows one piece of code to signal a condition and cooperating
    code to receive the signal and act upon it. */
@@ -308,7 +380,7 @@ cond_init (struct condition *cond)
 {
   ASSERT (cond != NULL);
 
-  list_init (&cond->waiters);
+  pqueue_init (&cond->waiters, cond_less_waiter, NULL);
 }
 
 /* Atomically releases LOCK and waits for COND to be signaled by
@@ -342,7 +414,8 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
-  list_push_back (&cond->waiters, &waiter.elem);
+  waiter.priority = thread_get_priority ();
+  pqueue_push (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
   lock_acquire (lock);
@@ -362,16 +435,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (lock_held_by_current_thread (lock));
-  struct list_elem *e;
+  struct pqueue_elem *e;
 
-  if (!list_empty (&cond->waiters)) 
+  if (!pqueue_empty (&cond->waiters)) 
     {
-
-
-      e = list_max (&cond->waiters, cond_less_sema_priority, NULL);
-      list_remove (e);
-      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
-
+      e = pqueue_pop (&cond->waiters);
+      sema_up (&pqueue_entry (e, struct semaphore_elem, elem)->semaphore);
     }
 }
 
@@ -387,154 +456,374 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   ASSERT (cond != NULL);
   ASSERT (lock != NULL);
 
-  while (!list_empty (&cond->waiters))
+  while (!pqueue_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
 
-/* Less function for semaphore_elem along each semaphore's maximum priority */
-bool
-cond_less_sema_priority (const struct list_elem* e1,
-                         const struct list_elem* e2,
-                         void* AUX UNUSED)
-{
-  struct semaphore_elem *s1 = list_entry (e1, struct semaphore_elem, elem);
-  struct semaphore_elem *s2 = list_entry (e2, struct semaphore_elem, elem);
-  struct thread *t1;
-  struct thread *t2;
-
-  if (list_empty (&s1->semaphore.waiters))
-    return true;
-  if (list_empty (&s2->semaphore.waiters))
-    return false;
-
-  t1 = list_entry (list_max (&s1->semaphore.waiters,
-                             thread_less_priority,
-                             NULL),
-                   struct thread,
-                   elem);
-
-  t2 = list_entry (list_max (&s2->semaphore.waiters,
-                             thread_less_priority,
-                             NULL),
-                   struct thread,
-                   elem);
-
-  return t1->priority < t2->priority;
+/* Less function for semaphore_elem along priority of its waiting thread */
+static bool
+cond_less_waiter (const struct pqueue_elem *e1,
+                  const struct pqueue_elem *e2,
+                  void *aux UNUSED)
+{
+  const struct semaphore_elem *s1 = pqueue_entry (e1, struct semaphore_elem,
+                                                  elem);
+  const struct semaphore_elem *s2 = pqueue_entry (e2, struct semaphore_elem,
+                                                  elem);
+  return s1->priority < s2->priority;
 }
 
+/* rw_lock state word.  Low bits are flags, the rest is the
+   number of active readers.  It is read and updated with
+   interrupts disabled, so an uncontended rw_lock costs no more
+   than that; threads queue only when they have to wait.
+
+   Lock is phase-fair: a reader arriving while a writer is active
+   or waiting waits for the end of next write phase, and when a
+   write phase ends all waiting readers are admitted at once, so
+   neither readers nor writers starve.  Waking up threads are
+   handed the lock directly by the thread releasing it. */
+#define RW_WRITER     0x01      /* A writer holds lock. */
+#define RW_EVICT      0x02      /* Being evicted, new lockers fail. */
+#define RW_READ_WAIT  0x04      /* Readers are waiting. */
+#define RW_WRITE_WAIT 0x08      /* Writers are waiting. */
+#define RW_READER     0x10      /* One active reader. */
+#define RW_READERS(STATE) ((STATE) / RW_READER)
+
+static bool rw_less_donor (const struct pqueue_elem *,
+                           const struct pqueue_elem *, void *aux);
+static void rw_block (struct rw_lock *);
+static void rw_release (struct rw_lock *, bool writer);
+static struct rw_hold *rw_hold_alloc (void);
+static void rw_hold_free (struct rw_hold *);
+static void rw_hold_add (struct rw_lock *, struct rw_hold *);
+static struct rw_hold *rw_hold_remove (struct rw_lock *);
+
 void rw_init (struct rw_lock *rw)
 {
-  lock_init (&rw->lock);
-  cond_init (&rw->cond_read);
-  cond_init (&rw->cond_write);
-  cond_init (&rw->cond_evict);
-  rw->is_evict = false;
-  rw->write_first = false;
-  rw->r_wait = rw->r_active = 0;
-  rw->w_wait = rw->w_active = 0;
+  rw->state = 0;
+  list_init (&rw->read_waiters);
+  pqueue_init (&rw->write_waiters, sema_less_waiter, NULL);
+  rw->evictor = NULL;
+  list_init (&rw->holders);
+  pqueue_init (&rw->donors, rw_less_donor, NULL);
+  rw->priority_max = PRI_MIN;
 }
 
+/* Acquires RW for reading, waiting while a writer holds it or
+   waits for it.  Returns false if RW is being evicted. */
 bool rw_rd_lock (struct rw_lock *rw)
 {
-  lock_acquire (&rw->lock);
-//  printf ("rd_lock\n");
-  if (rw->is_evict)
-  {
-    lock_release (&rw->lock);
-    return false;
-  }
-
-  ++rw->r_wait;
-  while (rw->w_active || rw->write_first)
-    cond_wait (&rw->cond_read, &rw->lock);
-  --rw->r_wait;
-  ++rw->r_active;
-
-  lock_release (&rw->lock);
-//  printf ("rd_lock_done\n");
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+  struct rw_hold *h;
+
+  ASSERT (!intr_context ());
+
+  h = rw_hold_alloc ();
+  old_level = intr_disable ();
+  if (rw->state & RW_EVICT)
+    {
+      intr_set_level (old_level);
+      rw_hold_free (h);
+      return false;
+    }
+
+  /* Fast path: no writer active or waiting */
+  if (!(rw->state & (RW_WRITER | RW_WRITE_WAIT)))
+    rw->state += RW_READER;
+  else
+    {
+      /* Writer ending its phase counts us as reader */
+      t->rw_write = false;
+      list_push_back (&rw->read_waiters, &t->elem);
+      rw->state |= RW_READ_WAIT;
+      rw_block (rw);
+    }
+  rw_hold_add (rw, h);
+  intr_set_level (old_level);
   return true;
 }
 
+/* Acquires RW for writing, waiting while it has any holder or
+   waiter.  Returns false if RW is being evicted. */
 bool rw_wr_lock (struct rw_lock *rw)
 {
-  lock_acquire (&rw->lock);
-//  printf ("wr_lock\n");
-  if (rw->is_evict)
-  {
-    lock_release (&rw->lock);
-    return false;
-  }
-
-  ++rw->w_wait;
-
-  if (rw->w_wait > 1)
-    rw->write_first = true;
+  struct thread *t = thread_current ();
+  enum intr_level old_level;
+  struct rw_hold *h;
 
-  while (rw->w_active || rw->r_active)
-    cond_wait (&rw->cond_write, &rw->lock);
+  ASSERT (!intr_context ());
 
-  --rw->w_wait;
-  ++rw->w_active;
+  h = rw_hold_alloc ();
+  old_level = intr_disable ();
+  if (rw->state & RW_EVICT)
+    {
+      intr_set_level (old_level);
+      rw_hold_free (h);
+      return false;
+    }
 
-  lock_release (&rw->lock);
-//  printf ("wr_lock done\n");
+  /* Fast path: lock is free */
+  if (rw->state == 0)
+    rw->state = RW_WRITER;
+  else
+    {
+      /* Releasing thread sets RW_WRITER for us */
+      t->rw_write = true;
+      pqueue_push (&rw->write_waiters, &t->waitelem);
+      rw->state |= RW_WRITE_WAIT;
+      rw_block (rw);
+    }
+  rw_hold_add (rw, h);
+  intr_set_level (old_level);
   return true;
 }
 
+/* Makes new lockers of RW fail, then waits until all holders and
+   waiters of RW are done. */
 void rw_evict_lock (struct rw_lock *rw)
 {
-  lock_acquire (&rw->lock);
+  enum intr_level old_level;
 
-  rw->is_evict = true;
-  while (rw->r_active || rw->w_active || rw->r_wait || rw->w_wait)
-    cond_wait (&rw->cond_evict, &rw->lock);
+  ASSERT (!intr_context ());
 
-  lock_release (&rw->lock);
+  old_level = intr_disable ();
+  ASSERT (!(rw->state & RW_EVICT));
+  rw->state |= RW_EVICT;
+  if (rw->state != RW_EVICT)
+    {
+      ASSERT (rw->evictor == NULL);
+      rw->evictor = thread_current ();
+      thread_current ()->rw_write = false;
+      while (rw->state != RW_EVICT)
+        rw_block (rw);
+      rw->evictor = NULL;
+    }
+  intr_set_level (old_level);
 }
 
+/* Releases RW held for reading. */
 void rw_rd_unlock (struct rw_lock *rw)
 {
-  lock_acquire (&rw->lock);
-//  printf ("rd_unlock\n");
+  enum intr_level old_level = intr_disable ();
+  struct rw_hold *h;
 
-  --rw->r_active;
-  if (rw->w_wait > 1)
-    rw->write_first = true;
+  ASSERT (RW_READERS (rw->state) > 0);
+  h = rw_hold_remove (rw);
+  rw->state -= RW_READER;
+  rw_release (rw, false);
+  intr_set_level (old_level);
+  rw_hold_free (h);
+}
 
-  if (rw->r_active == 0 && rw->w_wait > 0)
-    cond_signal (&rw->cond_write, &rw->lock);
+/* Releases RW held for writing. */
+void rw_wr_unlock (struct rw_lock *rw)
+{
+  enum intr_level old_level = intr_disable ();
+  struct rw_hold *h;
 
-  if (!(rw->r_active || rw->w_active || rw->r_wait || rw->w_wait))
-    cond_signal (&rw->cond_evict, &rw->lock);
+  ASSERT (rw->state & RW_WRITER);
+  h = rw_hold_remove (rw);
+  rw->state &= ~RW_WRITER;
+  rw_release (rw, true);
+  intr_set_level (old_level);
+  rw_hold_free (h);
+}
 
-  lock_release (&rw->lock);
-//  printf ("rd_unlock done\n");
+/* Lets new lockers of RW succeed again. */
+void rw_evict_unlock (struct rw_lock *rw)
+{
+  enum intr_level old_level = intr_disable ();
+  rw->state &= ~RW_EVICT;
+  intr_set_level (old_level);
 }
-void rw_wr_unlock (struct rw_lock *rw)
+
+/* Blocks current thread, queued as a waiter of RW, until lock is
+   handed to it.  Donates priority to holders of RW meanwhile.
+   Interrupts must be off. */
+static void
+rw_block (struct rw_lock *rw)
 {
-  lock_acquire (&rw->lock);
-//  printf ("wr_unlock\n");
+  struct thread *t = thread_current ();
 
-  --rw->w_active;
+  ASSERT (intr_get_level () == INTR_OFF);
 
-  ASSERT (rw->w_active == 0);
-  rw->write_first = false;
+  if (!thread_mlfqs)
+    {
+      t->rw_waiting = rw;
+      pqueue_push (&rw->donors, &t->rwelem);
+      thread_donate_priority ();
+    }
+  thread_block ();
+  if (!thread_mlfqs)
+    {
+      pqueue_remove (&rw->donors, &t->rwelem);
+      t->rw_waiting = NULL;
+      thread_rw_donors_changed (rw);
+    }
+}
+
+/* Hands RW over to waiters after a holder released it.  After a
+   write phase all waiting readers are admitted, after the last
+   reader the next writer, and the evictor once RW is idle.  WRITER
+   tells whether a writer released RW.  Interrupts must be off. */
+static void
+rw_release (struct rw_lock *rw, bool writer)
+{
+  struct thread *t;
+
+  ASSERT (intr_get_level () == INTR_OFF);
 
-  if (rw->w_wait)
-    cond_signal (&rw->cond_write, &rw->lock);
+  /* Still held by other readers */
+  if (RW_READERS (rw->state) > 0)
+    return;
+
+  if ((rw->state & RW_READ_WAIT)
+      && (writer || !(rw->state & RW_WRITE_WAIT)))
+    {
+      /* Start read phase with every waiting reader */
+      rw->state &= ~RW_READ_WAIT;
+      while (!list_empty (&rw->read_waiters))
+        {
+          t = list_entry (list_pop_front (&rw->read_waiters),
+                          struct thread, elem);
+          rw->state += RW_READER;
+          thread_unblock (t);
+        }
+    }
+  else if (rw->state & RW_WRITE_WAIT)
+    {
+      /* Start write phase with highest priority writer */
+      t = pqueue_entry (pqueue_pop (&rw->write_waiters),
+                        struct thread, waitelem);
+      if (pqueue_empty (&rw->write_waiters))
+        rw->state &= ~RW_WRITE_WAIT;
+      rw->state |= RW_WRITER;
+      thread_unblock (t);
+    }
+  else if (rw->evictor != NULL && rw->state == RW_EVICT)
+    thread_unblock (rw->evictor);
   else
-    cond_broadcast (&rw->cond_read, &rw->lock);
+    return;
+  thread_check_yield ();
+}
 
-  if (!(rw->r_active || rw->w_active || rw->r_wait || rw->w_wait))
-    cond_signal (&rw->cond_evict, &rw->lock);
+/* Priority of T, waiting for RW, changed.  Fix its place in RW's
+   waiters. */
+void
+rw_requeue (struct rw_lock *rw, struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->rw_waiting == rw);
 
-  lock_release (&rw->lock);
-//  printf ("wr_unlock done\n");
+  pqueue_remove (&rw->donors, &t->rwelem);
+  pqueue_push (&rw->donors, &t->rwelem);
+  if (t->rw_write)
+    {
+      pqueue_remove (&rw->write_waiters, &t->waitelem);
+      pqueue_push (&rw->write_waiters, &t->waitelem);
+    }
 }
 
-void rw_evict_unlock (struct rw_lock *rw)
+/* Returns an unused rw_hold for current thread to record its
+   next hold of a rw_lock: one of its own, or a newly allocated
+   one if all of those are in use.  Called with interrupts on,
+   before waiting for the rw_lock, since allocation may sleep.
+   Returns a null pointer if donation is off or memory is
+   exhausted, in which case the hold gets no donation. */
+static struct rw_hold *
+rw_hold_alloc (void)
+{
+  struct thread *t = thread_current ();
+  int i;
+
+  if (thread_mlfqs)
+    return NULL;
+
+  /* Only current thread sets or clears its own rw_hold's rw */
+  for (i = 0; i < RW_HOLD_CNT; i++)
+    if (t->rw_hold[i].rw == NULL)
+      return &t->rw_hold[i];
+  return malloc (sizeof (struct rw_hold));
+}
+
+/* Frees H, obtained from rw_hold_alloc(), if it was allocated.
+   Interrupts must be on. */
+static void
+rw_hold_free (struct rw_hold *h)
+{
+  struct thread *t = thread_current ();
+
+  if (h < t->rw_hold || h >= t->rw_hold + RW_HOLD_CNT)
+    free (h);
+}
+
+/* Records current thread as holder of RW in H.  Interrupts must
+   be off. */
+static void
+rw_hold_add (struct rw_lock *rw, struct rw_hold *h)
+{
+  struct thread *t = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (h == NULL)
+    return;
+
+  h->rw = rw;
+  h->holder = t;
+  list_push_back (&rw->holders, &h->elem);
+  pqueue_push (&t->rw_holds, &h->heap_elem);
+  thread_priority_update ();
+}
+
+/* Removes record of current thread holding RW, dropping
+   donations through it.  Returns the rw_hold, to be passed to
+   rw_hold_free() once interrupts are back on, or a null pointer
+   if the hold was not recorded.  Interrupts must be off. */
+static struct rw_hold *
+rw_hold_remove (struct rw_lock *rw)
 {
-  lock_acquire (&rw->lock);
-  rw->is_evict = false;
-  lock_release (&rw->lock);
+  struct thread *t = thread_current ();
+  struct list_elem *e;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (e = list_begin (&rw->holders); e != list_end (&rw->holders);
+       e = list_next (e))
+    {
+      struct rw_hold *h = list_entry (e, struct rw_hold, elem);
+      if (h->holder == t)
+        {
+          list_remove (&h->elem);
+          pqueue_remove (&t->rw_holds, &h->heap_elem);
+          h->rw = NULL;
+          thread_priority_update ();
+          return h;
+        }
+    }
+  return NULL;
+}
+
+/* Less function that compares rw_hold's rw_lock priority_max */
+bool
+rw_less_priority_max (const struct pqueue_elem *e1,
+                      const struct pqueue_elem *e2,
+                      void *aux UNUSED)
+{
+  const struct rw_hold *h1 = pqueue_entry (e1, struct rw_hold, heap_elem);
+  const struct rw_hold *h2 = pqueue_entry (e2, struct rw_hold, heap_elem);
+  return h1->rw->priority_max < h2->rw->priority_max;
+}
+
+/* Less function that orders rw_lock donors by priority */
+static bool
+rw_less_donor (const struct pqueue_elem *e1,
+               const struct pqueue_elem *e2,
+               void *aux UNUSED)
+{
+  const struct thread *t1 = pqueue_entry (e1, struct thread, rwelem);
+  const struct thread *t2 = pqueue_entry (e2, struct thread, rwelem);
+  return t1->priority < t2->priority;
 }
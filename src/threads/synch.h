@@ -2,15 +2,18 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <pqueue.h>
 #include <stdbool.h>
 #include <debug.h>
 
+struct thread;
+
 /* A counting semaphore. */
 struct semaphore 
   {
     unsigned value;             /* Current value. */
-    struct list waiters;        /* List of waiting threads. */
-    int priority_max;           /* Maximum priority value in list_waiters */
+    struct pqueue waiters;      /* Waiting threads, highest priority first. */
+    int priority_max;           /* Maximum priority value in waiters */
   };
 
 void sema_init (struct semaphore *, unsigned value);
@@ -18,19 +21,21 @@ void sema_down (struct semaphore *);
 bool sema_try_down (struct semaphore *);
 void sema_up (struct semaphore *);
 void sema_self_test (void);
-/* Less functions for max priority of semaphores */
-bool sema_less_priority_max (const struct list_elem* e1,
-                             const struct list_elem* e2,
-                             void* AUX UNUSED);
+void sema_requeue (struct semaphore *, struct thread *);
 
 /* Lock. */
 struct lock 
   {
     struct thread *holder;      /* Thread holding lock (for debugging). */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
-    struct list_elem elem;      /* List element for locks in thread (see thread.h) */
+    struct pqueue_elem elem;    /* Element for locks in thread (see thread.h) */
   };
 
+/* Less function for locks by max priority of their waiters */
+bool lock_less_priority_max (const struct pqueue_elem *e1,
+                             const struct pqueue_elem *e2,
+                             void *aux UNUSED);
+
 void lock_init (struct lock *);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
@@ -40,30 +45,43 @@ bool lock_held_by_current_thread (const struct lock *);
 /* Condition variable. */
 struct condition 
   {
-    struct list waiters;        /* List of waiting threads. */
+    struct pqueue waiters;      /* Waiters, highest priority first. */
   };
 
 void cond_init (struct condition *);
 void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
-/* Less function that determine which semaphore has less maximum priority */
-bool cond_less_sema_priority (const struct list_elem* e1,
-                              const struct list_elem* e2,
-                              void* AUX UNUSED);
 
 
-/* Lock for reader & writer */
+/* One hold of a rw_lock by a thread, reader or writer.  Threads
+   waiting for the rw_lock donate priority to every holder.  Each
+   thread has RW_HOLD_CNT of them, and allocates more while it
+   holds more rw_locks than that. */
+#define RW_HOLD_CNT 4           /* rw_hold embedded in each thread. */
+struct rw_hold
+  {
+    struct rw_lock *rw;         /* Held rw_lock, NULL if unused. */
+    struct thread *holder;      /* Thread holding rw. */
+    struct list_elem elem;      /* Element in rw's holders. */
+    struct pqueue_elem heap_elem; /* Element in holder's rw_holds. */
+  };
+
+/* Less function for rw_holds by max priority of rw's waiters */
+bool rw_less_priority_max (const struct pqueue_elem *e1,
+                           const struct pqueue_elem *e2,
+                           void *aux UNUSED);
+
+/* Lock for reader & writer, phase-fair (see synch.c) */
 struct rw_lock
 {
-  struct condition cond_read;   /* Condition for readers */
-  struct condition cond_write;  /* Condition for writers */
-  struct condition cond_evict;  /* Condition for eviction */
-  bool is_evict;                /* Is it to evicted or not ?? */
-  bool write_first;             /* Is write is prefered or not? */
-  int r_wait, r_active;         /* Read waiters cnt and read active cnt */
-  int w_wait, w_active;         /* Write waiters cnt and write active cnt */
-  struct lock lock;             /* Lock for mutual exclusion */
+  unsigned state;               /* Reader count, writer bit and flags */
+  struct list read_waiters;     /* Readers waiting for write phase end */
+  struct pqueue write_waiters;  /* Writers waiting, highest priority first */
+  struct thread *evictor;       /* Thread waiting in rw_evict_lock */
+  struct list holders;          /* rw_hold of readers or writer */
+  struct pqueue donors;         /* Waiting threads, highest priority first */
+  int priority_max;             /* Maximum priority value in donors */
 };
 
 void rw_init (struct rw_lock *);
@@ -73,6 +91,7 @@ void rw_evict_lock (struct rw_lock *);
 void rw_rd_unlock (struct rw_lock *);
 void rw_wr_unlock (struct rw_lock *);
 void rw_evict_unlock (struct rw_lock *);
+void rw_requeue (struct rw_lock *, struct thread *);
 
 /* Optimization barrier.
 
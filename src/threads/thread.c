@@ -11,6 +11,7 @@
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
 #ifdef USERPROG
 #include "userprog/process.h"
 #endif
@@ -26,9 +27,14 @@
    Do not modify this value. */
 #define THREAD_BASIC 0xd42df210
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Run queue of processes in THREAD_READY state, that is,
+   processes that are ready to run but not actually running.
+   There is one FIFO list per priority, and bit P of ready_mask is
+   set iff ready_queues[P] is not empty, so the highest priority
+   ready thread is found in constant time. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint64_t ready_mask;
+static size_t ready_cnt;        /* # of threads in run queue. */
 
 /* List of all processes. Processes are added to this list
  * when they are first scheduled and removed when they exit. */
@@ -71,6 +77,11 @@ static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
+static void ready_push (struct thread *);
+static void ready_remove (struct thread *);
+static int ready_max_priority (void);
+static void thread_set_effective_priority (struct thread *, int priority);
+static void thread_donate (struct thread *, int depth);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
 static void schedule (void);
@@ -83,6 +94,24 @@ static tid_t allocate_tid (void);
 /* Load average for advanced scheduler */
 static int load_avg;
 
+/* Advanced scheduler bookkeeping is incremental, so that timer
+   interrupt does not walk all threads.
+
+   Threads whose recent_cpu grew since the last priority update
+   are in ran_list.  Once a second, decay_epoch is advanced and
+   its decay coefficient 2*load_avg/(2*load_avg+1) is recorded;
+   each thread applies the epochs it missed lazily, when it is
+   unblocked or picked to run.  Ready threads are in decay_list
+   in FIFO order, so threads still to be decayed are at its
+   front, and a few of them are decayed at every tick. */
+#define DECAY_HISTORY 64        /* # of recorded decay coefficients. */
+#define DECAY_BATCH 8           /* # of ready threads decayed per tick. */
+static struct list ran_list;
+static struct list decay_list;
+static int decay_coef[DECAY_HISTORY];
+static int decay_epoch;
+static void thread_decay_catch_up (struct thread *);
+
 /* Initializes the threading system by transforming the code
    that's currently running into a thread.  This can't work in
    general and it is possible in this case only because loader.S
@@ -101,9 +130,17 @@ thread_init (void)
 {
   ASSERT (intr_get_level () == INTR_OFF);
 
+  int i;
+
   lock_init (&tid_lock);
-  list_init (&ready_list);
+  for (i = PRI_MIN; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
+  ready_mask = 0;
+  ready_cnt = 0;
   list_init (&all_list);
+  list_init (&ran_list);
+  list_init (&decay_list);
+  decay_epoch = 0;
 
 
   /* Set up a thread structure for the running thread. */
@@ -150,8 +187,9 @@ thread_tick (void)
   else
     kernel_ticks++;
 
-  /* Enforce preemption. */
-  if (++thread_ticks >= TIME_SLICE)
+  /* Enforce preemption.  Ticks skipped while idle are caught up
+     outside the timer interrupt, and idle thread blocks anyway. */
+  if (++thread_ticks >= TIME_SLICE && intr_context ())
     intr_yield_on_return ();
 }
 
@@ -276,8 +314,14 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  if (thread_mlfqs)
+    {
+      /* Apply decays missed while blocked before queueing */
+      thread_decay_catch_up (t);
+      list_push_back (&decay_list, &t->decayelem);
+    }
   t->status = THREAD_READY;
+  ready_push (t);
   intr_set_level (old_level);
 }
 
@@ -329,6 +373,8 @@ thread_exit (int status)
      We will be destroyed during the call to schedule_tail(). */
   intr_disable ();
   list_remove (&thread_current ()->allelem);
+  if (thread_current ()->ran)
+    list_remove (&thread_current ()->ranelem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -345,9 +391,13 @@ thread_yield (void)
   ASSERT (!intr_context ());
 
   old_level = intr_disable ();
-  if (curr != idle_thread) 
-    list_push_back (&ready_list, &curr->elem);
   curr->status = THREAD_READY;
+  if (curr != idle_thread) 
+    {
+      if (thread_mlfqs)
+        list_push_back (&decay_list, &curr->decayelem);
+      ready_push (curr);
+    }
   schedule ();
   intr_set_level (old_level);
 }
@@ -361,13 +411,9 @@ thread_set_priority (int new_priority)
   int priority_prev = t->priority;
   t->priority_origin = new_priority;
 
-  //t->priority = new_priority;
-  // thread_priority_update ();
-//  if (priority_prev < t->priority)
-//    {
-//      // if (!thread_mlfqs)
-//        // thread_donate_priority ();
-//    }
+  /* Effective priority is still bounded below by donations */
+  if (!thread_mlfqs)
+    thread_priority_update ();
   if (priority_prev > t->priority)
     thread_check_yield ();
   intr_set_level (old_level);
@@ -380,49 +426,121 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Donate current thread's priority if it is waiting for lock */
-void
-thread_donate_priority (void) {
-  struct thread *t = thread_current ();
-  struct lock *l = t->lock_waiting;
-  int donation_depth = 0;
-  while (l) 
+/* Returns priority that T should run at: its own priority, or the
+   highest priority donated by waiters of locks and rw_locks that
+   T holds.  Both are at the tops of T's heaps, so this is O(1). */
+static int
+thread_donated_priority (struct thread *t)
+{
+  int priority = t->priority_origin;
+
+  if (!pqueue_empty (&t->locks))
     {
-      if (!l->holder)
-        break;
-      if (l->holder->priority >= t->priority)
-        break;
-      l->holder->priority = t->priority;
-      t = l->holder;
-     if (l->semaphore.priority_max < t->priority)
-        l->semaphore.priority_max = t->priority;
-      l = t->lock_waiting;
-      donation_depth ++;
+      struct lock *l = pqueue_entry (pqueue_top (&t->locks),
+                                     struct lock, elem);
+      if (l->semaphore.priority_max > priority)
+        priority = l->semaphore.priority_max;
+    }
+  if (!pqueue_empty (&t->rw_holds))
+    {
+      struct rw_hold *h = pqueue_entry (pqueue_top (&t->rw_holds),
+                                        struct rw_hold, heap_elem);
+      if (h->rw->priority_max > priority)
+        priority = h->rw->priority_max;
+    }
+  return priority;
+}
+
+/* Lock L's priority_max may have changed, fix its place in its
+   holder's locks and pass the change on to the holder. */
+static void
+thread_donate_lock (struct lock *l, int depth)
+{
+  if (l->holder == NULL)
+    return;
+  pqueue_remove (&l->holder->locks, &l->elem);
+  pqueue_push (&l->holder->locks, &l->elem);
+  if (depth < DONATE_DEPTH_LIMIT)
+    thread_donate (l->holder, depth + 1);
+}
+
+/* Donors of RW may have changed, update its priority_max, fix its
+   place in every holder's rw_holds and pass the change on to all
+   holders. */
+static void
+thread_donate_rw (struct rw_lock *rw, int depth)
+{
+  struct list_elem *e;
+
+  if (pqueue_empty (&rw->donors))
+    rw->priority_max = PRI_MIN;
+  else
+    rw->priority_max = pqueue_entry (pqueue_top (&rw->donors),
+                                     struct thread, rwelem)->priority;
+
+  for (e = list_begin (&rw->holders); e != list_end (&rw->holders);
+       e = list_next (e))
+    {
+      struct rw_hold *h = list_entry (e, struct rw_hold, elem);
+      pqueue_remove (&h->holder->rw_holds, &h->heap_elem);
+      pqueue_push (&h->holder->rw_holds, &h->heap_elem);
+      if (depth < DONATE_DEPTH_LIMIT)
+        thread_donate (h->holder, depth + 1);
     }
 }
 
-/* Reset threads priority */
+/* Recomputes T's priority from donations.  If it changed and T is
+   waiting for a lock or rw_lock, the change is passed on to its
+   holders, up to DONATE_DEPTH_LIMIT holders away. */
+static void
+thread_donate (struct thread *t, int depth)
+{
+  int priority = thread_donated_priority (t);
+  if (priority == t->priority)
+    return;
+
+  /* Requeues T in semaphore waiters, so that lock's priority_max
+     is also updated */
+  thread_set_effective_priority (t, priority);
+  if (t->lock_waiting != NULL)
+    thread_donate_lock (t->lock_waiting, depth);
+  if (t->rw_waiting != NULL)
+    {
+      rw_requeue (t->rw_waiting, t);
+      thread_donate_rw (t->rw_waiting, depth);
+    }
+}
+
+/* Donate current thread's priority to holders of lock or rw_lock
+   it is about to wait for.  Caller has already queued current
+   thread as a waiter. */
 void
-thread_reset_donation (struct lock *l)
+thread_donate_priority (void)
 {
-  list_remove (&l->elem);
-  thread_priority_update ();
+  struct thread *t = thread_current ();
+
+  ASSERT (intr_get_level () == INTR_OFF);
+  if (t->lock_waiting != NULL)
+    thread_donate_lock (t->lock_waiting, 0);
+  if (t->rw_waiting != NULL)
+    thread_donate_rw (t->rw_waiting, 0);
+}
+
+/* Donors of RW changed, e.g. a waiter stopped waiting. */
+void
+thread_rw_donors_changed (struct rw_lock *rw)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  thread_donate_rw (rw, 0);
 }
   
-/* Update current_thread's priority.
- * Check locks that it holds and check their maximum priority and set */
+/* Update current_thread's priority, after it acquired or released
+   a lock or rw_lock or changed its own priority. */
 void
-thread_priority_update (void) {
-  struct thread *t = thread_current ();
-  struct list_elem *e;
-  e = list_max (&t->locks, sema_less_priority_max, NULL);
-  int locks_priority_max = list_entry (e, 
-                                       struct lock,
-                                       elem)->semaphore.priority_max;
-  if (locks_priority_max > t->priority_origin)
-    t->priority = locks_priority_max;
-  else
-    t->priority = t->priority_origin;
+thread_priority_update (void)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  thread_donate (thread_current (), DONATE_DEPTH_LIMIT);
 }
 
 /* Sets the current thread's nice value to NICE. */
@@ -457,7 +575,8 @@ thread_get_recent_cpu (void)
   return FP_INT_NEAR (FP_INT_MUL (thread_current ()->recent_cpu, 100));
 }
 
-/* Increase current thread's recent cpu */
+/* Increase current thread's recent cpu, and remember that its
+   priority should be updated */
 void
 thread_incr_recent_cpu (void)
 {
@@ -466,19 +585,41 @@ thread_incr_recent_cpu (void)
   if (t == idle_thread)
     return;
   t->recent_cpu = FP_INT_ADD (t->recent_cpu, 1);
+  if (!t->ran)
+    {
+      t->ran = true;
+      list_push_back (&ran_list, &t->ranelem);
+    }
 }
 
-/* Update recent cpu of given thread t. */
-void
-thread_update_recent_cpu (struct thread *t)
+/* Apply recent_cpu decays that thread t missed since its last
+   decay, and update its priority. */
+static void
+thread_decay_catch_up (struct thread *t)
 {
+  int epoch, coef;
+
   ASSERT (thread_mlfqs);
-  ASSERT (t != idle_thread);
-  int temp1 = FP_INT_MUL (load_avg, 2);
-  int temp2 = FP_INT_ADD (FP_INT_MUL (load_avg, 2), 1);
-  temp1 = FP_DIV (temp1, temp2);
-  temp2 = FP_MUL (temp1, t->recent_cpu);
-  t->recent_cpu = FP_INT_ADD (temp2, t->nice);
+  if (t == idle_thread || t->decay_epoch == decay_epoch)
+    return;
+
+  epoch = t->decay_epoch + 1;
+  if (decay_epoch - t->decay_epoch > DECAY_HISTORY)
+    {
+      /* Coefficients of such old epochs are forgotten.  After that
+         many decays recent_cpu converged to the fixed point of
+         recent_cpu = coef * recent_cpu + nice, nice / (1 - coef). */
+      epoch = decay_epoch - DECAY_HISTORY + 1;
+      coef = decay_coef[epoch % DECAY_HISTORY];
+      t->recent_cpu = FP_DIV (INT_FP (t->nice), (F - coef));
+    }
+  for (; epoch <= decay_epoch; epoch++)
+    {
+      coef = decay_coef[epoch % DECAY_HISTORY];
+      t->recent_cpu = FP_INT_ADD (FP_MUL (coef, t->recent_cpu), t->nice);
+    }
+  t->decay_epoch = decay_epoch;
+  thread_mlfqs_update_priority (t);
 }
 
 /* Update thread t's priority among advanced scheduler's rule */
@@ -491,41 +632,58 @@ thread_mlfqs_update_priority (struct thread *t)
   int priority_new = INT_FP (PRI_MAX);
   priority_new = FP_SUB (priority_new, FP_INT_DIV (t->recent_cpu, 4));
   priority_new = FP_INT_SUB (priority_new , t->nice * 2);
-  t->priority = FP_INT_ZERO (priority_new);
-  if (t->priority > PRI_MAX)
-    t->priority = PRI_MAX;
-  else if (t->priority < PRI_MIN)
-    t->priority = PRI_MIN;
+  priority_new = FP_INT_ZERO (priority_new);
+  if (priority_new > PRI_MAX)
+    priority_new = PRI_MAX;
+  else if (priority_new < PRI_MIN)
+    priority_new = PRI_MIN;
+  thread_set_effective_priority (t, priority_new);
 }
 
-/* For every thread in all_list, update it's priority using 
- * thread_mlfqs_update_priority */
+/* Update priority of threads in ran_list, since priority of
+ * other threads did not change */
 void 
-thread_update_priority_all (void) 
+thread_update_priority_ran (void) 
 {
-  struct thread *t;
-  struct list_elem *e;
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
+  ASSERT (thread_mlfqs);
+  while (!list_empty (&ran_list))
     {
-      t = list_entry (e, struct thread, allelem);
-      if (t != idle_thread)
-        thread_mlfqs_update_priority (t);
-    }  
+      struct thread *t = list_entry (list_pop_front (&ran_list),
+                                     struct thread, ranelem);
+      t->ran = false;
+      thread_mlfqs_update_priority (t);
+    }
 }
 
-/* Update all threads recent cpu value using thread_update_recent_cpu */
+/* Start new decay epoch of recent_cpu.  Only running thread is
+ * decayed now, others catch up lazily */
 void
-thread_update_recent_cpu_all (void)
+thread_decay_recent_cpu (void)
 {
-  struct thread *t;
-  struct list_elem *e;
-  for (e = list_begin (&all_list); e != list_end (&all_list);
-       e = list_next (e))
+  ASSERT (thread_mlfqs);
+  int temp1 = FP_INT_MUL (load_avg, 2);
+  int temp2 = FP_INT_ADD (FP_INT_MUL (load_avg, 2), 1);
+  decay_epoch++;
+  decay_coef[decay_epoch % DECAY_HISTORY] = FP_DIV (temp1, temp2);
+  thread_decay_catch_up (thread_current ());
+}
+
+/* Decay a batch of ready threads that missed recent decay epochs */
+void
+thread_decay_ready (void)
+{
+  int i;
+
+  ASSERT (thread_mlfqs);
+  for (i = 0; i < DECAY_BATCH && !list_empty (&decay_list); i++)
     {
-      t = list_entry (e, struct thread, allelem);
-      if (t != idle_thread)
-        thread_update_recent_cpu (t);
+      struct thread *t = list_entry (list_front (&decay_list),
+                                     struct thread, decayelem);
+      if (t->decay_epoch == decay_epoch)
+        break;
+      thread_decay_catch_up (t);
+      list_remove (&t->decayelem);
+      list_push_back (&decay_list, &t->decayelem);
     }
 }
 
@@ -533,7 +691,7 @@ thread_update_recent_cpu_all (void)
 void
 thread_update_load_avg (void)
 {
-  size_t num_ready_threads = list_size (&ready_list);
+  size_t num_ready_threads = ready_cnt;
   int temp1, temp2;
   if (thread_current () != idle_thread)
     num_ready_threads++;
@@ -553,32 +711,18 @@ thread_less_priority (const struct list_elem* e1,
   return t1->priority < t2->priority;
 }
 
-/* Less function for threads */
-bool thread_less_ticks_wakeup (const struct list_elem* e1,
-                               const struct list_elem* e2,
-                               void *AUX UNUSED)
-{
-  const struct thread *t1 = list_entry(e1, struct thread, elem);
-  const struct thread *t2 = list_entry(e2, struct thread, elem);
-  return t1->ticks_wakeup < t2->ticks_wakeup;
-}
-
-/* Check whether thread should yield or not */
+/* Check whether thread should yield or not.  In an interrupt
+   handler (e.g. a timer callout), yields on return instead. */
 void thread_check_yield (void) 
 {
   struct thread *t1 = thread_current ();
-  struct thread *t2;
-  if (list_empty (&ready_list))
-    return;
-  t2 = list_entry (list_max (&ready_list,
-                             thread_less_priority,
-                             NULL),
-                   struct thread,
-                   elem);
-  if (list_empty (&ready_list)) 
-    return;
-  if (t1->priority < t2->priority) 
-    thread_yield ();
+  if (t1->priority < ready_max_priority ())
+    {
+      if (intr_context ())
+        intr_yield_on_return ();
+      else
+        thread_yield ();
+    }
 }
 
 
@@ -604,6 +748,15 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else to run, prepare zeroed pages meanwhile. */
+      intr_enable ();
+      if (palloc_zero_idle ())
+        continue;
+      intr_disable ();
+
+      /* Skip timer ticks until the next timer event. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -678,22 +831,22 @@ init_thread (struct thread *t, const char *name, int priority)
       t->nice = 0;
       t->recent_cpu = 0;
     }
+  t->decay_epoch = decay_epoch;
   t->lock_waiting = NULL;
+  t->sema_waiting = NULL;
   t->magic = THREAD_MAGIC;
-  list_init (&t->locks);
+  pqueue_init (&t->locks, lock_less_priority_max, NULL);
+  pqueue_init (&t->rw_holds, rw_less_priority_max, NULL);
   /* Initial userprog process */
 #ifdef USERPROG
-  /* File entry list initialization */
-  list_init (&t->files);
+  /* Open file table initialization, fds 0 to 2 are reserved */
+  idtable_init (&t->files, 3);
   /* Init child processes list initialization */
   list_init (&t->list_child);
-  /* Set fd_next */
-  t->fd_next = 3;
 #endif
 
 #ifdef VM
-	list_init (&t->mmap_list);
-	t->mapid_next = 1;
+	idtable_init (&t->mmaps, 1);
 #endif
 
   list_push_back (&all_list, &t->allelem);
@@ -720,15 +873,86 @@ alloc_frame (struct thread *t, size_t size)
 static struct thread *
 next_thread_to_run (void) 
 {
-  struct list_elem *e;
-  if (list_empty (&ready_list))
-    return idle_thread;
+  int priority;
+  struct thread *t;
+
+  for (;;)
+    {
+      priority = ready_max_priority ();
+      if (priority < PRI_MIN)
+        return idle_thread;
+      t = list_entry (list_front (&ready_queues[priority]), struct thread, elem);
+      if (!thread_mlfqs || t->decay_epoch == decay_epoch || t == idle_thread)
+        break;
+      /* Decay may raise its priority or requeue it, choose again */
+      thread_decay_catch_up (t);
+    }
+  ready_remove (t);
+  if (thread_mlfqs)
+    list_remove (&t->decayelem);
+  return t;
+}
+
+/* Appends T to the run queue of its priority. */
+static void
+ready_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->priority >= PRI_MIN && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_mask |= (uint64_t) 1 << t->priority;
+  ready_cnt++;
+}
+
+/* Removes T from the run queue of its priority. */
+static void
+ready_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority]))
+    ready_mask &= ~((uint64_t) 1 << t->priority);
+  ready_cnt--;
+}
+
+/* Returns the highest priority among ready threads, or
+   PRI_MIN - 1 if the run queue is empty. */
+static int
+ready_max_priority (void)
+{
+  uint32_t hi = ready_mask >> 32;
+  uint32_t lo = ready_mask;
+  if (hi != 0)
+    return 63 - __builtin_clz (hi);
+  else if (lo != 0)
+    return 31 - __builtin_clz (lo);
   else
-  {
-    e = list_max (&ready_list, thread_less_priority, NULL);
-    list_remove (e);
-    return list_entry (e, struct thread, elem);
-  }
+    return PRI_MIN - 1;
+}
+
+/* Sets T's effective priority to PRIORITY.  If T is ready, it is
+   moved to the back of the run queue of its new priority, and if
+   T is waiting for a semaphore, its place in the semaphore's
+   waiters is updated. */
+static void
+thread_set_effective_priority (struct thread *t, int priority)
+{
+  if (t->priority == priority)
+    return;
+  if (t->status == THREAD_READY)
+    {
+      ready_remove (t);
+      t->priority = priority;
+      ready_push (t);
+    }
+  else
+    {
+      t->priority = priority;
+      if (t->status == THREAD_BLOCKED && t->sema_waiting != NULL)
+        sema_requeue (t->sema_waiting, t);
+    }
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -795,6 +1019,11 @@ schedule (void)
   ASSERT (curr->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
 
+  /* Leaving the idle thread, however it was woken up, so the
+     timer must tick again. */
+  if (curr == idle_thread && next != idle_thread)
+    timer_idle_exit ();
+
   if (curr != next)
     prev = switch_threads (curr, next);
   schedule_tail (prev); 
@@ -4,6 +4,7 @@
 #include <debug.h>
 #include <list.h>
 #include <hash.h>
+#include <idtable.h>
 #include <stdint.h>
 #include "threads/synch.h"
 
@@ -126,23 +127,31 @@ struct thread
     struct list_elem allelem;
 
     /* For synch */
-    struct list locks;                  /* List of locks that thread holds */
+    struct pqueue locks;                /* Locks held, by waiters' priority */
     struct lock *lock_waiting;          /* Lock that thread waiting for */
-
-    int64_t ticks_wakeup;               /* Ticks when thread wake up */
+    struct rw_hold rw_hold[RW_HOLD_CNT]; /* rw_hold ready for use */
+    struct pqueue rw_holds;             /* rw_hold in use, by waiters' priority */
+    struct rw_lock *rw_waiting;         /* rw_lock that thread waiting for */
+    bool rw_write;                      /* Waiting for rw_lock to write? */
+    struct pqueue_elem rwelem;          /* Element in rw_lock donors */
+    struct pqueue_elem waitelem;        /* Element in semaphore waiters */
+    struct semaphore *sema_waiting;     /* Semaphore that thread waiting for */
 
     /* Properties for advanced scheduler */
     int nice;
     int recent_cpu;
+    int decay_epoch;                    /* Last recent_cpu decay applied */
+    bool ran;                           /* In ran_list? */
+    struct list_elem decayelem;         /* Element in decay_list */
+    struct list_elem ranelem;           /* Element in ran_list */
 
 #ifdef USERPROG
     /* Owned by userprog/process.c. */
     uint32_t *pagedir;                  /* Page directory. */
     struct file *excutable;
-    struct list files;                  /* Open files list */
+    struct idtable files;               /* Open files, by fd */
     struct list list_child;             /* child processes list */
     struct shared_status *child_shared_status;
-    int fd_next;                        /* Fd number that to be allocated */
     //struct process_msg child_parent;    /* Informations between child and parent */
 #endif
 
@@ -153,8 +162,7 @@ struct thread
     void *esp;                          /* For saving esp value in system call */
 
     /* For mmap support */
-    struct list mmap_list;              /* List of mmapped entries */
-    int mapid_next;                     /* mapid_t that to be allocated */
+    struct idtable mmaps;               /* Mmapped entries, by mapid_t */
 
     /* For sub directory operations */
     disk_sector_t cwd;                    /* Current working directory */
@@ -201,25 +209,20 @@ int thread_get_load_avg (void);
 
 /* Additional functions for priority scheduling */
 void thread_donate_priority (void);
-void thread_reset_donation (struct lock *l);
 void thread_priority_update (void);
+void thread_rw_donors_changed (struct rw_lock *rw);
 
 /* Additional functions for advanced scheduling */
 void thread_incr_recent_cpu (void);
-void thread_update_recent_cpu (struct thread *t);
 void thread_mlfqs_update_priority (struct thread *t);
-void thread_update_priority_all (void);
-void thread_update_recent_cpu_all (void);
+void thread_update_priority_ran (void);
+void thread_decay_recent_cpu (void);
+void thread_decay_ready (void);
 void thread_update_load_avg (void);
 
 /* Yield check */
 void thread_check_yield (void);
 
-/* Less function that checks which one has small ticks_wakeup */
-bool thread_less_ticks_wakeup (const struct list_elem* e1,
-                               const struct list_elem* e2,
-                               void *AUX UNUSED);
-
 /* Less function that checks which one has less priority */
 bool thread_less_priority (const struct list_elem* e1,
                            const struct list_elem* e2,
@@ -2,6 +2,7 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
@@ -11,6 +12,7 @@
 static long long page_fault_cnt;
 
 static void kill (struct intr_frame *);
+static void debug_exception (struct intr_frame *);
 static void page_fault (struct intr_frame *);
 
 /* Registers handlers for interrupts that can be caused by user
@@ -45,7 +47,8 @@ exception_init (void)
      caused indirectly, e.g. #DE can be caused by dividing by
      0.  */
   intr_register_int (0, 0, INTR_ON, kill, "#DE Divide Error");
-  intr_register_int (1, 0, INTR_ON, kill, "#DB Debug Exception");
+  intr_register_int (1, 0, INTR_ON, debug_exception,
+                     "#DB Debug Exception");
   intr_register_int (6, 0, INTR_ON, kill, "#UD Invalid Opcode Exception");
   intr_register_int (7, 0, INTR_ON, kill,
                      "#NM Device Not Available Exception");
@@ -110,6 +113,30 @@ kill (struct intr_frame *f)
     }
 }
 
+/* Bounds of the SYSENTER entry point in sysenter.S. */
+extern char sysenter_entry[], sysenter_entry_end[];
+
+/* Debug exception handler.
+
+   SYSENTER does not clear the trap flag, so a user program that
+   sets TF with POPF and then executes SYSENTER single-steps into
+   sysenter_entry, in the kernel's code segment.  That is not a
+   kernel bug, so instead of killing the kernel we clear TF and
+   let the system call proceed.  Every other debug exception is
+   treated like any other user exception. */
+static void
+debug_exception (struct intr_frame *f)
+{
+  if (f->cs == SEL_KCSEG
+      && (char *) f->eip >= sysenter_entry
+      && (char *) f->eip < sysenter_entry_end)
+    {
+      f->eflags &= ~FLAG_TF;
+      return;
+    }
+  kill (f);
+}
+
 /* Page fault handler.  This is a skeleton that must be filled in
    to implement virtual memory.  Some solutions to project 2 may
    also require modifying this code.
@@ -162,6 +189,11 @@ page_fault (struct intr_frame *f)
   {
     return;
   }
+  /* Write on page shared after fork, copy it */
+  else if (!not_present && write && vm_copy_on_write (fault_addr))
+  {
+    return;
+  }
   else
   {
     thread_exit (-1);
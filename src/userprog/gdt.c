@@ -29,6 +29,7 @@ static uint64_t make_code_desc (int dpl);
 static uint64_t make_data_desc (int dpl);
 static uint64_t make_tss_desc (void *laddr);
 static uint64_t make_gdtr_operand (uint16_t limit, void *base);
+static void sysenter_init (void);
 
 /* Sets up a proper GDT.  The bootstrap loader's GDT didn't
    include user-mode selectors or a TSS, but we need both now. */
@@ -51,6 +52,54 @@ gdt_init (void)
   gdtr_operand = make_gdtr_operand (sizeof gdt - 1, gdt);
   asm volatile ("lgdt %0" : : "m" (gdtr_operand));
   asm volatile ("ltr %w0" : : "r" (SEL_TSS));
+
+  sysenter_init ();
+}
+
+/* SYSENTER support.  See [IA32-v3a] 4.8.7 "Performing Fast
+   Calls to System Procedures with the SYSENTER and SYSEXIT
+   Instructions". */
+#define CPUID_SEP 0x00000800    /* CPUID.1:EDX, SYSENTER supported. */
+#define MSR_SYSENTER_CS 0x174   /* Kernel code selector. */
+#define MSR_SYSENTER_ESP 0x175  /* Kernel stack pointer. */
+#define MSR_SYSENTER_EIP 0x176  /* Kernel entry point. */
+
+/* Entry point in sysenter.S. */
+void sysenter_entry (void);
+
+/* Writes VALUE to model-specific register MSR. */
+static inline void
+wrmsr (uint32_t msr, uint32_t value)
+{
+  asm volatile ("wrmsr" : : "c" (msr), "a" (value), "d" (0));
+}
+
+/* Enables SYSENTER system calls if the CPU supports them.  User
+   programs make the same check with CPUID and otherwise fall
+   back to `int $0x30'. */
+static void
+sysenter_init (void)
+{
+  uint32_t eax = 1, ebx, ecx, edx;
+  unsigned family, model, stepping;
+
+  /* SYSENTER and SYSEXIT derive the other selectors from the
+     kernel code selector. */
+  ASSERT (SEL_KDSEG == SEL_KCSEG + 8);
+  ASSERT (SEL_UCSEG == ((SEL_KCSEG + 16) | 3));
+  ASSERT (SEL_UDSEG == ((SEL_KCSEG + 24) | 3));
+
+  /* Early Pentium Pro report SEP without really supporting it. */
+  asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+  family = (eax >> 8) & 0xf;
+  model = (eax >> 4) & 0xf;
+  stepping = eax & 0xf;
+  if (!(edx & CPUID_SEP) || (family == 6 && model < 3 && stepping < 3))
+    return;
+
+  wrmsr (MSR_SYSENTER_CS, SEL_KCSEG);
+  wrmsr (MSR_SYSENTER_ESP, (uint32_t) tss_esp0 ());
+  wrmsr (MSR_SYSENTER_EIP, (uint32_t) sysenter_entry);
 }
 
 /* System segment or code/data segment? */
@@ -3,6 +3,7 @@
 #include <stddef.h>
 #include <string.h>
 #include "threads/init.h"
+#include "threads/interrupt.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
 #include "vm/vm.h"
@@ -12,6 +13,25 @@
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static uint32_t *lookup_large (uint32_t *pd, const void *vaddr);
+static void split_large (uint32_t *pd, uint32_t *pde);
+static void *take_reserved_pt (uint32_t *pde);
+
+/* A page table set aside when a 4 MB page is mapped, so that
+   the mapping can later be split into 4 kB pages without
+   allocating memory.  Eviction is what splits large pages, and
+   it runs exactly when memory is short.
+   Until it is used, the page table's own memory holds this
+   record. */
+struct reserved_pt
+  {
+    struct reserved_pt *next;   /* Next reserved page table. */
+    uint32_t *pde;              /* 4 MB page directory entry. */
+  };
+
+/* Reserved page tables, for all page directories.  4 MB pages
+   are few, so a simple chain is enough. */
+static struct reserved_pt *reserved_pts;
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -38,7 +58,9 @@ pagedir_destroy (uint32_t *pd)
 
   ASSERT (pd != base_page_dir);
   for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
-    if (*pde & PTE_P) 
+    if ((*pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS))
+      palloc_free_page (take_reserved_pt (pde));
+    else if (*pde & PTE_P)
       {
         uint32_t *pt = pde_get_pt (*pde);
         uint32_t *pte;
@@ -68,8 +90,12 @@ lookup_page (uint32_t *pd, const void *vaddr, bool create)
   ASSERT (!create || is_user_vaddr (vaddr));
 
   /* Check for a page table for VADDR.
-     If one is missing, create one if requested. */
+     If one is missing, create one if requested.
+     If VADDR is in a 4 MB page, split it into 4 kB pages so
+     that the caller can work on the page table entry. */
   pde = pd + pd_no (vaddr);
+  if (*pde & PTE_PS)
+    split_large (pd, pde);
   if (*pde == 0) 
     {
       if (create)
@@ -132,7 +158,11 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
   uint32_t *pte;
 
   ASSERT (is_user_vaddr (uaddr));
-  
+
+  pte = lookup_large (pd, uaddr);
+  if (pte != NULL)
+    return pde_get_large_page (*pte) + ((uintptr_t) uaddr & ~PDE_LARGE_ADDR);
+
   pte = lookup_page (pd, uaddr, false);
   if (pte != NULL && (*pte & PTE_P) != 0)
     return pte_get_page (*pte) + pg_ofs (uaddr);
@@ -140,6 +170,45 @@ pagedir_get_page (uint32_t *pd, const void *uaddr)
     return NULL;
 }
 
+/* Adds a 4 MB page mapping in page directory PD from user
+   virtual address UPAGE to the physically contiguous frames
+   starting at kernel virtual address KPAGE.  Both must be 4 MB
+   aligned, and no page table may exist yet for UPAGE.
+   If WRITABLE is true, the new pages are read/write; otherwise
+   they are read-only.
+   Returns true if successful, false if 4 MB pages are not
+   available, UPAGE is already covered by a page table, or the
+   page table to split the mapping into later cannot be
+   allocated. */
+bool
+pagedir_set_large_page (uint32_t *pd, void *upage, void *kpage,
+                        bool writable)
+{
+  struct reserved_pt *r;
+  enum intr_level old_level;
+  uint32_t *pde;
+
+  ASSERT (((uintptr_t) upage & ~PDE_LARGE_ADDR) == 0);
+  ASSERT (is_user_vaddr (upage + PTSPAN - 1));
+  ASSERT (pd != base_page_dir);
+
+  pde = pd + pd_no (upage);
+  if (!large_pages || *pde != 0)
+    return false;
+
+  r = palloc_get_page (0);
+  if (r == NULL)
+    return false;
+  r->pde = pde;
+  old_level = intr_disable ();
+  r->next = reserved_pts;
+  reserved_pts = r;
+  intr_set_level (old_level);
+
+  *pde = pde_create_large (kpage, writable);
+  return true;
+}
+
 /* Marks user virtual page UPAGE "not present" in page
    directory PD.  Later accesses to the page will fault.  Other
    bits in the page table entry are preserved.
@@ -167,7 +236,9 @@ pagedir_clear_page (uint32_t *pd, void *upage)
 bool
 pagedir_is_dirty (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   return pte != NULL && (*pte & PTE_D) != 0;
 }
 
@@ -176,7 +247,11 @@ pagedir_is_dirty (uint32_t *pd, const void *vpage)
 void
 pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  /* Marking one page of a 4 MB page dirty may mark all of it,
+     but clearing needs the page's own entry. */
+  uint32_t *pte = dirty ? lookup_large (pd, vpage) : NULL;
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   if (pte != NULL) 
     {
       if (dirty)
@@ -189,6 +264,34 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
     }
 }
 
+/* Sets the writable bit to WRITABLE in the PTE for virtual page
+   VPAGE in PD. */
+void
+pagedir_set_writable (uint32_t *pd, const void *vpage, bool writable)
+{
+  uint32_t *pte = lookup_page (pd, vpage, false);
+  if (pte != NULL)
+    {
+      if (writable)
+        *pte |= PTE_W;
+      else
+        *pte &= ~(uint32_t) PTE_W;
+      invalidate_pagedir (pd);
+    }
+}
+
+/* Returns true if the PTE for virtual page VPAGE in PD is
+   present and writable.  Returns false if PD contains no PTE
+   for VPAGE. */
+bool
+pagedir_is_writable (uint32_t *pd, const void *vpage)
+{
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
+  return pte != NULL && (*pte & (PTE_P | PTE_W)) == (PTE_P | PTE_W);
+}
+
 /* Returns true if the PTE for virtual page VPAGE in PD has been
    accessed recently, that is, between the time the PTE was
    installed and the last time it was cleared.  Returns false if
@@ -196,7 +299,9 @@ pagedir_set_dirty (uint32_t *pd, const void *vpage, bool dirty)
 bool
 pagedir_is_accessed (uint32_t *pd, const void *vpage) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   return pte != NULL && (*pte & PTE_A) != 0;
 }
 
@@ -205,7 +310,11 @@ pagedir_is_accessed (uint32_t *pd, const void *vpage)
 void
 pagedir_set_accessed (uint32_t *pd, const void *vpage, bool accessed) 
 {
-  uint32_t *pte = lookup_page (pd, vpage, false);
+  /* A 4 MB page keeps one accessed bit for all its frames, so
+     that the eviction clock's sweep does not split it. */
+  uint32_t *pte = lookup_large (pd, vpage);
+  if (pte == NULL)
+    pte = lookup_page (pd, vpage, false);
   if (pte != NULL) 
     {
       if (accessed)
@@ -234,6 +343,53 @@ pagedir_activate (uint32_t *pd)
   asm volatile ("movl %0, %%cr3" : : "r" (vtop (pd)) : "memory");
 }
 
+/* Returns the address of the page directory entry of PD if it
+   maps VADDR with a 4 MB page, or a null pointer otherwise. */
+static uint32_t *
+lookup_large (uint32_t *pd, const void *vaddr)
+{
+  uint32_t *pde = pd + pd_no (vaddr);
+  return (*pde & (PTE_P | PTE_PS)) == (PTE_P | PTE_PS) ? pde : NULL;
+}
+
+/* Replaces 4 MB page mapping PDE of PD by the page table
+   reserved for it, mapping the same frames with 4 kB pages.
+   Accessed and dirty bits of the 4 MB page are copied into every
+   page table entry. */
+static void
+split_large (uint32_t *pd, uint32_t *pde)
+{
+  uint32_t *pt = take_reserved_pt (pde);
+  uint8_t *page = pde_get_large_page (*pde);
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *pt; i++)
+    pt[i] = pte_create_user (page + i * PGSIZE, (*pde & PTE_W) != 0)
+            | (*pde & (PTE_A | PTE_D));
+  *pde = pde_create (pt);
+  invalidate_pagedir (pd);
+}
+
+/* Removes the page table reserved for 4 MB page directory entry
+   PDE from the reserved list and returns it. */
+static void *
+take_reserved_pt (uint32_t *pde)
+{
+  struct reserved_pt **rp, *r;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  for (rp = &reserved_pts; *rp != NULL; rp = &(*rp)->next)
+    if ((*rp)->pde == pde)
+      break;
+  r = *rp;
+  ASSERT (r != NULL);
+  *rp = r->next;
+  intr_set_level (old_level);
+
+  return r;
+}
+
 /* Returns the currently active page directory. */
 static uint32_t *
 active_pd (void) 
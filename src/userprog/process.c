@@ -23,6 +23,8 @@
 #include "vm/vm.h"
 
 static thread_func start_process NO_RETURN;
+static thread_func start_fork NO_RETURN;
+static bool fork_files (struct thread *parent);
 static bool load (const char *cmdline, void (**eip) (void), void **esp);
 
 
@@ -119,6 +121,120 @@ start_process (void *f_name)
   NOT_REACHED ();
 }
 
+/* Creates a child process which is a copy of the current one,
+   resuming from the system call interrupt frame F.  User pages
+   are shared copy-on-write (see vm_fork), and open files are
+   duplicated.  Returns child's tid in parent, or TID_ERROR if
+   the child cannot be created. */
+tid_t
+process_fork (struct intr_frame *f)
+{
+  tid_t tid;
+  bool is_child_forked = true;
+  struct shared_status *st;
+  void *args[4];
+
+  st = malloc (sizeof (struct shared_status));
+  if (st == NULL)
+    return TID_ERROR;
+  st->parent = thread_tid ();
+  sema_init (&st->synch, 0);
+  st->exit_status = 0;
+  st->is_child_exit = false;
+  st->p_status = PARENT_RUNNING;
+  list_push_back (&thread_current ()->list_child, &st->elem);
+  args[0] = (void *) thread_current ();
+  args[1] = (void *) st;
+  args[2] = (void *) &is_child_forked;
+  args[3] = (void *) f;
+
+  tid = thread_create (thread_name (), PRI_DEFAULT, start_fork, (void *) args);
+  if (tid == TID_ERROR)
+    {
+      list_remove (&st->elem);
+      free (st);
+      return TID_ERROR;
+    }
+  /* Wait until child duplicates address space */
+  sema_down (&st->synch);
+  st->child = tid;
+  return is_child_forked ? tid : TID_ERROR;
+}
+
+/* A thread function that duplicates parent process and makes it
+   start running from parent's system call return with 0. */
+static void
+start_fork (void *aux)
+{
+  struct thread *parent = ((struct thread **)aux)[0];
+  struct shared_status *st = ((struct shared_status **)aux)[1];
+  bool *is_fork_success = ((bool **)aux)[2];
+  struct thread *curr = thread_current ();
+  struct intr_frame if_;
+  bool success = false;
+
+  /* Copy parent's user context, child returns 0 from fork */
+  memcpy (&if_, ((struct intr_frame **)aux)[3], sizeof if_);
+  if_.eax = 0;
+
+  vm_init_page ();
+  curr->pagedir = pagedir_create ();
+  if (curr->pagedir == NULL)
+    goto done;
+  process_activate ();
+
+  curr->excutable = file_reopen (parent->excutable);
+  if (curr->excutable == NULL)
+    goto done;
+  file_deny_write (curr->excutable);
+
+  success = fork_files (parent) && vm_fork (parent);
+
+ done:
+  *is_fork_success = success;
+  sema_up (&st->synch);
+  if (!success)
+    thread_exit (-1);
+
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Duplicates open files of PARENT into current process.
+   Each file has its own file position copied from parent. */
+static bool
+fork_files (struct thread *parent)
+{
+  struct thread *curr = thread_current ();
+  int fd;
+
+  for (fd = idtable_next (&parent->files, 0); fd >= 0;
+       fd = idtable_next (&parent->files, fd + 1))
+    {
+      struct fd_entry *pfe = idtable_lookup (&parent->files, fd);
+      struct fd_entry *fe = malloc (sizeof (struct fd_entry));
+      if (fe == NULL)
+        return false;
+      fe->file = file_reopen (pfe->file);
+      if (fe->file == NULL)
+        {
+          free (fe);
+          return false;
+        }
+      file_seek (fe->file, file_tell (pfe->file));
+      fe->dir = pfe->dir ? dir_open (file_get_inode (fe->file)) : NULL;
+      if (!idtable_insert_at (&curr->files, fd, fe))
+        {
+          if (fe->dir)
+            dir_close (fe->dir);
+          file_close (fe->file);
+          free (fe);
+          return false;
+        }
+    }
+  return true;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -648,16 +764,7 @@ static struct mmap_entry *get_mmap_entry (mapid_t mid);
 static struct fd_entry *
 get_fd_entry (int fd)
 {
-  struct list_elem *e;
-  struct thread *curr = thread_current ();
-  for (e = list_begin (&curr->files); e != list_end (&curr->files);
-       e = list_next (e))
-    {
-      struct fd_entry *fe = list_entry (e, struct fd_entry, elem);
-      if (fe->fd == fd)
-        return fe;
-    }
-  return NULL;
+  return idtable_lookup (&thread_current ()->files, fd);
 }
 
 static void
@@ -667,25 +774,23 @@ clear_resources (void)
   struct fd_entry *fe;
   struct shared_status *st;
   struct list_elem *e;
-  struct mmap_entry *me;
+  int id;
   /* Remove mmap entry */
-  while (!list_empty (&curr->mmap_list))
-  {
-    e = list_front (&curr->mmap_list);
-    me = list_entry (e, struct mmap_entry, elem);
-    list_remove (e);
-    free (me);
-  }
+  for (id = idtable_next (&curr->mmaps, 0); id >= 0;
+       id = idtable_next (&curr->mmaps, id + 1))
+    free (idtable_lookup (&curr->mmaps, id));
+  idtable_destroy (&curr->mmaps);
   /* Remove open file entry */
-  while (!list_empty (&curr->files))
+  for (id = idtable_next (&curr->files, 0); id >= 0;
+       id = idtable_next (&curr->files, id + 1))
   {
-    fe = list_entry (list_pop_front (&curr->files),
-                     struct fd_entry, elem);
+    fe = idtable_lookup (&curr->files, id);
     if (fe->dir)
       dir_close (fe->dir);
     file_close (fe->file);
     free (fe);
   }
+  idtable_destroy (&curr->files);
   /* Send signal to childs that parent exit */
   for (e = list_begin (&curr->list_child); e != list_end (&curr->list_child);)
   {
@@ -713,15 +818,26 @@ int process_open (const char *file)
     return -1;
   }
   struct fd_entry *fe = malloc (sizeof (struct fd_entry));
+  if (fe == NULL)
+  {
+    file_close (f);
+    return -1;
+  }
   fe->file = f;
-  fe->fd = curr->fd_next++;
   if (file_isdir (f))
     fe->dir = dir_open (file_get_inode (f));
   else
     fe->dir = NULL;
 
-  list_push_back (&curr->files, &fe->elem);
-  return fe->fd;
+  int fd = idtable_insert (&curr->files, fe);
+  if (fd < 0)
+  {
+    if (fe->dir)
+      dir_close (fe->dir);
+    file_close (f);
+    free (fe);
+  }
+  return fd;
 }
 
 int process_filesize (int fd)
@@ -752,7 +868,8 @@ int process_read (int fd, void *buffer, unsigned size)
   struct fd_entry *fe = get_fd_entry (fd);
   if (fe == NULL)
     return -1;
-  return file_read (fe->file, buffer, (off_t) size);
+  /* Go through page cache, so mmaped pages are coherent with read */
+  return vm_file_read (fe->file, buffer, (off_t) size);
 }
 
 int process_write (int fd, void *buffer, unsigned size)
@@ -765,7 +882,73 @@ int process_write (int fd, void *buffer, unsigned size)
   struct fd_entry *fe = get_fd_entry (fd);
   if (fe == NULL)
     return -1;
-  return file_write (fe->file, buffer, (off_t) size);
+  /* Go through page cache, so mmaped pages are coherent with write */
+  return vm_file_write (fe->file, buffer, (off_t) size);
+}
+
+int process_readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  if (fd == STDIN_FILENO)
+    {
+      int bytes = 0;
+      int i;
+      for (i = 0; i < iovcnt; i++)
+        {
+          int n = process_read (fd, iov[i].iov_base, iov[i].iov_len);
+          bytes += n;
+          if ((size_t) n != iov[i].iov_len)
+            break;
+        }
+      return bytes;
+    }
+  struct fd_entry *fe = get_fd_entry (fd);
+  if (fe == NULL)
+    return -1;
+  return vm_file_readv (fe->file, iov, iovcnt);
+}
+
+int process_writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  if (fd == STDOUT_FILENO)
+    {
+      int bytes = 0;
+      int i;
+      for (i = 0; i < iovcnt; i++)
+        {
+          putbuf (iov[i].iov_base, iov[i].iov_len);
+          bytes += iov[i].iov_len;
+        }
+      return bytes;
+    }
+  struct fd_entry *fe = get_fd_entry (fd);
+  if (fe == NULL)
+    return -1;
+  return vm_file_writev (fe->file, iov, iovcnt);
+}
+
+int process_pread (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct fd_entry *fe = get_fd_entry (fd);
+  if (fe == NULL || (int) size < 0 || (int) offset < 0)
+    return -1;
+  return vm_file_read_at (fe->file, buffer, (off_t) size, (off_t) offset);
+}
+
+int process_pwrite (int fd, void *buffer, unsigned size, unsigned offset)
+{
+  struct fd_entry *fe = get_fd_entry (fd);
+  if (fe == NULL || (int) size < 0 || (int) offset < 0)
+    return -1;
+  return vm_file_write_at (fe->file, buffer, (off_t) size, (off_t) offset);
+}
+
+int process_copy_file_range (int fd_in, int fd_out, unsigned size)
+{
+  struct fd_entry *in = get_fd_entry (fd_in);
+  struct fd_entry *out = get_fd_entry (fd_out);
+  if (in == NULL || out == NULL || (int) size < 0)
+    return -1;
+  return vm_file_copy (out->file, in->file, (off_t) size);
 }
 
 int process_seek (int fd, unsigned position)
@@ -787,13 +970,12 @@ int process_tell (int fd)
 
 int process_close (int fd)
 {
-  struct fd_entry *fe = get_fd_entry (fd);
+  struct fd_entry *fe = idtable_remove (&thread_current ()->files, fd);
   if (fe == NULL)
     return -1;
   file_close (fe->file);
   if (fe->dir)
     dir_close (fe->dir);
-  list_remove (&fe->elem);
   free (fe);
   return 0;
 }
@@ -802,16 +984,7 @@ int process_close (int fd)
 static struct mmap_entry *
 get_mmap_entry (mapid_t mid)
 {
-  struct list_elem *e;
-  struct thread *curr = thread_current ();
-  for (e = list_begin (&curr->mmap_list); e != list_end (&curr->mmap_list);
-       e = list_next (e))
-  {
-    struct mmap_entry *me = list_entry (e, struct mmap_entry, elem);
-    if (me->mid == mid)
-      return me;
-  }
-  return NULL;
+  return idtable_lookup (&thread_current ()->mmaps, mid);
 }
 
 /* Mmap for given file entry */
@@ -852,11 +1025,26 @@ int process_munmap (mapid_t mid)
   /*  Close file */
   file_close (file);
   /* Remove mmap entry */
-  list_remove (&me->elem);
+  idtable_remove (&thread_current ()->mmaps, mid);
   free (me);
   return 0;
 }
 
+/* Write back dirty pages of mapping MID.  With MS_ASYNC, pages are
+   left to periodic writeback of vm. */
+int process_msync (mapid_t mid, int flags)
+{
+  struct mmap_entry *me = get_mmap_entry (mid);
+  if (me == NULL)
+    return -1;
+  /* Exactly one of MS_ASYNC and MS_SYNC should be given */
+  if (flags != MS_ASYNC && flags != MS_SYNC)
+    return -1;
+  if (flags == MS_SYNC)
+    vm_msync (me);
+  return 0;
+}
+
 bool process_readdir (int fd, char *name)
 {
   struct fd_entry *fe = get_fd_entry (fd);
@@ -2,6 +2,7 @@
 #define USERPROG_PROCESS_H
 
 #include "threads/thread.h"
+#include "threads/interrupt.h"
 #include "filesys/directory.h"
 #include <user/syscall.h>
 
@@ -11,11 +12,10 @@ struct fd_entry
     struct file * file;
     /* If open entry is directory, get it */
     struct dir *dir;
-    int fd;
-    struct list_elem elem;
   };
 
 tid_t process_execute (const char *file_name);
+tid_t process_fork (struct intr_frame *f);
 int process_wait (tid_t);
 void process_exit (int);
 void process_activate (void);
@@ -24,11 +24,17 @@ int process_open (const char *file);
 int process_filesize (int fd);
 int process_read (int fd, void *buffer, unsigned size);
 int process_write (int fd, void *buffer, unsigned size);
+int process_readv (int fd, const struct iovec *iov, int iovcnt);
+int process_writev (int fd, const struct iovec *iov, int iovcnt);
+int process_pread (int fd, void *buffer, unsigned size, unsigned offset);
+int process_pwrite (int fd, void *buffer, unsigned size, unsigned offset);
+int process_copy_file_range (int fd_in, int fd_out, unsigned size);
 int process_seek (int fd, unsigned position);
 int process_tell (int fd);
 int process_close (int fd);
 int process_mmap (int fd, void *addr);
 int process_munmap (mapid_t mid);
+int process_msync (mapid_t mid, int flags);
 bool process_readdir (int fd, char *name);
 bool process_isdir (int fd);
 int process_inumber (int fd);
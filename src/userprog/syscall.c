@@ -1,422 +1,534 @@
 #include "userprog/syscall.h"
+#include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 #include <user/syscall.h>
 #include <syscall-nr.h>
+#include "threads/cpu.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/init.h"
+#include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "vm/vm.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/directory.h"
 
 
 static void syscall_handler (struct intr_frame *);
-static int get_user (uint8_t *uaddr);
-static bool check_arguments (void *esp, int bytes);
-static bool check_buffer (void *buf, int size);
-static bool check_str (char *arg, int size);
-
+static bool check_user_page (const void *uaddr, bool write);
+static bool check_user_range (const void *uaddr, size_t size, bool write);
+static int user_strnlen (const char *ustr, int size);
+
+/* User memory is validated a page at a time: a page that is
+   mapped in the page directory is good as is, and one that is
+   not is faulted in through the supplemental page table, so
+   that checking a buffer costs one lookup per page it spans
+   rather than one fault-guarded load per byte. */
+
+/* Makes sure the user page containing UADDR is mapped, loading
+   it if needed.  If WRITE, also makes sure it is writable,
+   breaking copy-on-write sharing.  Returns false if UADDR is not
+   valid user memory. */
 static bool
-check_str (char *arg, int size)
+check_user_page (const void *uaddr, bool write)
 {
-  char ch;
-  int i = 0;
-  while ((ch = get_user ((uint8_t *) (arg + i))) != -1 && ch != '\0'
-         && (++i < size));
-  if (ch == -1)
+  struct thread *t = thread_current ();
+  void *upage = pg_round_down (uaddr);
+
+  if (uaddr == NULL || !is_user_vaddr (uaddr))
     return false;
-  return true;
+  for (;;)
+    {
+      if (pagedir_get_page (t->pagedir, upage) == NULL)
+        {
+          if (!vm_load ((void *) uaddr, t->esp))
+            return false;
+        }
+      else if (write && !pagedir_is_writable (t->pagedir, upage))
+        {
+          if (!vm_copy_on_write ((void *) uaddr))
+            return false;
+        }
+      else
+        return true;
+    }
 }
 
+/* Checks that SIZE bytes at UADDR are valid user memory, and
+   writable if WRITE. */
 static bool
-check_buffer (void *buf, int size)
-{
-  return check_arguments ((uint8_t *) buf, 1)
-         && check_arguments ((uint8_t *)buf + size, 1);
-}
-
-/*****************************************************/
-static void syscall_exit (struct intr_frame *f);
-static int syscall_wait (struct intr_frame *f);
-static int syscall_exec (struct intr_frame *f);
-static int syscall_create (struct intr_frame *f, int *status);
-static int syscall_remove (struct intr_frame *f, int *status);
-static int syscall_open (struct intr_frame *f, int *status);
-static int syscall_filesize (struct intr_frame *f);
-static int syscall_read (struct intr_frame *f, int *status);
-static int syscall_write (struct intr_frame *f, int *status);
-static int syscall_seek (struct intr_frame *f);
-static int syscall_tell (struct intr_frame *f);
-static int syscall_close (struct intr_frame *f);
-static int syscall_mmap (struct intr_frame *f);
-static int syscall_munmap (struct intr_frame *f);
-// For filesys
-static int syscall_chdir (struct intr_frame *f, int *status);
-static int syscall_mkdir (struct intr_frame *f, int *status);
-static int syscall_readdir (struct intr_frame *f, int *status);
-static int syscall_isdir (struct intr_frame *f);
-static int syscall_inumber (struct intr_frame *f);
-/***************************************************/
-
-static int syscall_wait (struct intr_frame *f)
-{
-  tid_t child_tid = *(tid_t *) (f->esp + 4);
-  int result = process_wait (child_tid);
-  return result;
-}
-
-static int syscall_exec (struct intr_frame *f)
-{
-  char *cmd = *(char **) (f->esp + 4);
-  int result;
-  if (cmd == NULL || !check_str (cmd, PGSIZE))
-    return -1;
-  if (strlen (cmd) > PGSIZE)
-    return -1;
-  result = process_execute ((const char *) cmd);
-  return result;
-}
+check_user_range (const void *uaddr, size_t size, bool write)
+{
+  const uint8_t *p = uaddr;
+  const uint8_t *last = p + size - 1;
 
+  if (size == 0)
+    return true;
+  if (last < p || !is_user_vaddr (last))
+    return false;
+  for (; p <= last; p = (const uint8_t *) pg_round_down (p) + PGSIZE)
+    if (!check_user_page (p, write))
+      return false;
+  return true;
+}
 
-static int syscall_create (struct intr_frame *f, int *status)
+/* Returns the length of user string USTR, or SIZE if it has no
+   null terminator in its first SIZE bytes.  Returns -1 if the
+   string runs into invalid memory. */
+static int
+user_strnlen (const char *ustr, int size)
 {
-  char *file = *(char **) (f->esp + 4);
-  unsigned initial_size = *(unsigned *) (f->esp + 8);
-  if (file == NULL || !check_str (file, 14))
+  int len = 0;
+
+  while (len < size)
     {
-      *status = -1;
-      return 0;
+      const char *p = ustr + len;
+      int chunk = PGSIZE - pg_ofs (p);
+      const char *end;
+
+      if (!check_user_page (p, false))
+        return -1;
+      if (chunk > size - len)
+        chunk = size - len;
+      end = memchr (p, '\0', chunk);
+      if (end != NULL)
+        return len + (end - p);
+      len += chunk;
     }
-  if (strlen (file) > 14)
-    return 0;
-  return filesys_create (file, initial_size, false);
+  return len;
 }
 
-static int syscall_remove (struct intr_frame *f, int *status)
+/* Copies SIZE bytes from user address USRC to DST.  Returns false
+   if USRC is not valid user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size)
 {
-  char *file = *(char **) (f->esp + 4);
-  if (file == NULL || !check_str (file, PGSIZE))
-    {
-      *status = -1;
-      return 0;
-    }
+  if (!check_user_range (usrc, size, false))
+    return false;
+  memcpy (dst, usrc, size);
+  return true;
+}
 
-  if (strlen (file) == 0)
+/* Copies SIZE bytes from SRC to user address UDST.  Returns false
+   if UDST is not valid, writable user memory. */
+bool
+copy_to_user (void *udst, const void *src, size_t size)
+{
+  if (!check_user_range (udst, size, true))
     return false;
+  memcpy (udst, src, size);
+  return true;
+}
 
-  return filesys_remove (file);
+/* Copies user string USRC into DST, which has room for SIZE
+   bytes.  Returns the length of the string, or SIZE if it did
+   not fit, in which case DST is not null terminated.  Returns -1
+   if USRC is not valid user memory. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size)
+{
+  int len = user_strnlen (usrc, size);
+
+  if (len < 0)
+    return -1;
+  memcpy (dst, usrc, (size_t) len < size ? (size_t) len + 1 : size);
+  return len;
 }
 
-static void syscall_exit (struct intr_frame *f)
+/* A decoded system call argument. */
+union syscall_arg
+  {
+    int i;                      /* ARG_INT. */
+    unsigned u;                 /* ARG_INT, unsigned. */
+    void *p;                    /* ARG_PTR, ARG_BUF_IN, ARG_BUF_OUT. */
+    const char *s;              /* ARG_STR. */
+  };
+
+/* Kinds of system call arguments, checked before dispatch. */
+enum syscall_arg_kind
+  {
+    ARG_INT,                    /* Plain value. */
+    ARG_PTR,                    /* User pointer checked by handler. */
+    ARG_STR,                    /* User string, null terminated or
+                                   PGSIZE bytes long. */
+    ARG_BUF_IN,                 /* User buffer read by the kernel,
+                                   size in the next argument. */
+    ARG_BUF_OUT                 /* User buffer written by the kernel,
+                                   size in the next argument. */
+  };
+
+#define SYSCALL_MAX_ARGS 4
+
+typedef int syscall_func (const union syscall_arg *, struct intr_frame *);
+
+/* System call table entry. */
+struct syscall
+  {
+    const char *name;           /* Name, for statistics. */
+    syscall_func *func;         /* Handler. */
+    int argc;                   /* Number of arguments. */
+    enum syscall_arg_kind kinds[SYSCALL_MAX_ARGS]; /* Argument kinds. */
+    int64_t calls;              /* Number of calls. */
+    int64_t cycles;             /* Total cycles in returning calls. */
+  };
+
+static syscall_func syscall_halt, syscall_exit, syscall_exec, syscall_wait,
+  syscall_create, syscall_remove, syscall_open, syscall_filesize,
+  syscall_read, syscall_write, syscall_seek, syscall_tell, syscall_close,
+  syscall_mmap, syscall_munmap, syscall_chdir, syscall_mkdir,
+  syscall_readdir, syscall_isdir, syscall_inumber, syscall_fork,
+  syscall_msync, syscall_readv, syscall_writev, syscall_pread,
+  syscall_pwrite, syscall_copy_file_range;
+
+/* System calls, indexed by number. */
+static struct syscall syscalls[] =
+  {
+    [SYS_HALT] = {"halt", syscall_halt, 0, {}},
+    [SYS_EXIT] = {"exit", syscall_exit, 1, {ARG_INT}},
+    [SYS_EXEC] = {"exec", syscall_exec, 1, {ARG_STR}},
+    [SYS_WAIT] = {"wait", syscall_wait, 1, {ARG_INT}},
+    [SYS_CREATE] = {"create", syscall_create, 2, {ARG_STR, ARG_INT}},
+    [SYS_REMOVE] = {"remove", syscall_remove, 1, {ARG_STR}},
+    [SYS_OPEN] = {"open", syscall_open, 1, {ARG_STR}},
+    [SYS_FILESIZE] = {"filesize", syscall_filesize, 1, {ARG_INT}},
+    [SYS_READ] = {"read", syscall_read, 3, {ARG_INT, ARG_BUF_OUT, ARG_INT}},
+    [SYS_WRITE] = {"write", syscall_write, 3, {ARG_INT, ARG_BUF_IN, ARG_INT}},
+    [SYS_SEEK] = {"seek", syscall_seek, 2, {ARG_INT, ARG_INT}},
+    [SYS_TELL] = {"tell", syscall_tell, 1, {ARG_INT}},
+    [SYS_CLOSE] = {"close", syscall_close, 1, {ARG_INT}},
+    [SYS_MMAP] = {"mmap", syscall_mmap, 2, {ARG_INT, ARG_PTR}},
+    [SYS_MUNMAP] = {"munmap", syscall_munmap, 1, {ARG_INT}},
+    [SYS_CHDIR] = {"chdir", syscall_chdir, 1, {ARG_STR}},
+    [SYS_MKDIR] = {"mkdir", syscall_mkdir, 1, {ARG_STR}},
+    [SYS_READDIR] = {"readdir", syscall_readdir, 2, {ARG_INT, ARG_PTR}},
+    [SYS_ISDIR] = {"isdir", syscall_isdir, 1, {ARG_INT}},
+    [SYS_INUMBER] = {"inumber", syscall_inumber, 1, {ARG_INT}},
+    [SYS_FORK] = {"fork", syscall_fork, 0, {}},
+    [SYS_MSYNC] = {"msync", syscall_msync, 2, {ARG_INT, ARG_INT}},
+    [SYS_READV] = {"readv", syscall_readv, 3, {ARG_INT, ARG_PTR, ARG_INT}},
+    [SYS_WRITEV] = {"writev", syscall_writev, 3, {ARG_INT, ARG_PTR, ARG_INT}},
+    [SYS_PREAD] = {"pread", syscall_pread, 4,
+                   {ARG_INT, ARG_BUF_OUT, ARG_INT, ARG_INT}},
+    [SYS_PWRITE] = {"pwrite", syscall_pwrite, 4,
+                    {ARG_INT, ARG_BUF_IN, ARG_INT, ARG_INT}},
+    [SYS_COPY_FILE_RANGE] = {"copy_file_range", syscall_copy_file_range, 3,
+                             {ARG_INT, ARG_INT, ARG_INT}},
+  };
+
+#define SYSCALL_CNT (sizeof syscalls / sizeof *syscalls)
+
+static int
+syscall_halt (const union syscall_arg *args UNUSED,
+              struct intr_frame *f UNUSED)
 {
-  int status = *(int *) (f->esp + 4);
-  thread_exit (status);
+  power_off ();
 }
 
-static int syscall_open (struct intr_frame *f, int *status)
+static int
+syscall_exit (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  char *file_name = *(char **) (f->esp + 4);
+  thread_exit (args[0].i);
+}
 
-  if (file_name == NULL || !check_str (file_name, PGSIZE))
-    {
-      *status = -1;
-      return -1;
-    }
+static int
+syscall_wait (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  return process_wait (args[0].i);
+}
 
-  if (strlen (file_name) == 0)
+static int
+syscall_exec (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  if (strnlen (args[0].s, PGSIZE) >= PGSIZE)
     return -1;
-  return process_open (file_name);
+  return process_execute (args[0].s);
 }
 
-static int syscall_filesize (struct intr_frame *f)
+static int
+syscall_fork (const union syscall_arg *args UNUSED, struct intr_frame *f)
 {
-  int fd = *(int *) (f->esp + 4);
-  return process_filesize (fd);
+  return process_fork (f);
 }
 
-static int syscall_read (struct intr_frame *f, int *status)
+static int
+syscall_create (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  void *buf = *(void **) (f->esp + 8);
-  unsigned size = *(unsigned *) (f->esp + 12);
-  if (!check_buffer ((uint8_t *) buf, size))
-    {
-      *status = -1;
-      return -1;
-    }
-  return process_read (fd, buf, size);
+  if (strnlen (args[0].s, NAME_MAX + 1) > NAME_MAX)
+    return false;
+  return filesys_create (args[0].s, args[1].u, false);
 }
 
-static int syscall_write (struct intr_frame *f, int *status)
+static int
+syscall_remove (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  void *buf = *(void **) (f->esp + 8);
-  unsigned size = *(unsigned *) (f->esp + 12);
-  if (!check_buffer ((uint8_t *)buf, size))
-    {
-      *status = -1;
-      return -1;
-    }
-  return process_write (fd, buf, size);
+  if (args[0].s[0] == '\0')
+    return false;
+  return filesys_remove (args[0].s);
 }
 
-static int syscall_seek (struct intr_frame *f)
+static int
+syscall_open (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  unsigned pos = *(unsigned *) (f->esp + 8);
-  return process_seek (fd, pos);
+  if (args[0].s[0] == '\0')
+    return -1;
+  return process_open (args[0].s);
 }
 
-static int syscall_tell (struct intr_frame *f)
+static int
+syscall_filesize (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  return process_tell (fd);
+  return process_filesize (args[0].i);
 }
 
-static int syscall_close (struct intr_frame *f)
+static int
+syscall_read (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  return process_close (fd);
+  return process_read (args[0].i, args[1].p, args[2].u);
 }
 
-static int syscall_mmap (struct intr_frame *f)
+static int
+syscall_write (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  void *addr = *(void **) (f->esp + 8);
-  return process_mmap (fd, addr);
+  return process_write (args[0].i, args[1].p, args[2].u);
 }
 
-static int syscall_munmap (struct intr_frame *f)
+static int
+syscall_seek (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  mapid_t mid = *(mapid_t *) (f->esp + 4);
-  return process_munmap (mid);
+  return process_seek (args[0].i, args[1].u);
 }
 
 static int
-syscall_mkdir (struct intr_frame *f, int *status)
+syscall_tell (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  char *dir_name = *(char **) (f->esp + 4);
-  if (dir_name == NULL || !check_str(dir_name, PGSIZE))
-  {
-    *status = -1;
-    return -1;
-  }
+  return process_tell (args[0].i);
+}
 
-  if (strlen (dir_name) == 0)
-    return false;
+static int
+syscall_close (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  return process_close (args[0].i);
+}
 
-  return filesys_create ((const char *) dir_name, 0, true);
+static int
+syscall_mmap (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  return process_mmap (args[0].i, args[1].p);
 }
 
 static int
-syscall_chdir (struct intr_frame *f, int *status)
+syscall_munmap (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  char *dir_name = *(char **) (f->esp + 4);
-  if (dir_name == NULL || !check_str(dir_name, PGSIZE))
-  {
-    *status = -1;
-    return -1;
-  }
+  return process_munmap (args[0].i);
+}
+
+static int
+syscall_msync (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  return process_msync (args[0].i, args[1].i);
+}
 
-  if (strlen (dir_name) == 0)
+/* Copies the IOVCNT buffer descriptors at user address UIOV into
+   IOV and checks the buffers, which must be writable if WRITE.
+   Returns false if the vector is invalid. */
+static bool
+copy_iovec_from_user (struct iovec *iov, const struct iovec *uiov,
+                      int iovcnt, bool write)
+{
+  size_t total = 0;
+  int i;
+
+  if (iovcnt < 0 || iovcnt > IOV_MAX
+      || !copy_from_user (iov, uiov, iovcnt * sizeof *iov))
     return false;
+  for (i = 0; i < iovcnt; i++)
+    {
+      total += iov[i].iov_len;
+      if (iov[i].iov_len > INT_MAX || total > INT_MAX
+          || !check_user_range (iov[i].iov_base, iov[i].iov_len, write))
+        return false;
+    }
+  return true;
+}
+
+static int
+syscall_readv (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  struct iovec iov[IOV_MAX];
 
-  return filesys_chdir ((const char *) dir_name);
+  if (!copy_iovec_from_user (iov, args[1].p, args[2].i, true))
+    thread_exit (-1);
+  return process_readv (args[0].i, iov, args[2].i);
 }
 
 static int
-syscall_readdir (struct intr_frame *f, int *status)
+syscall_writev (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp + 4);
-  char *name = *(char **) (f->esp + 8);
-  if (name == NULL || !check_str (name, 14))
-  {
-    *status = -1;
-    return -1;
-  }
-  return process_readdir (fd, name);
+  struct iovec iov[IOV_MAX];
+
+  if (!copy_iovec_from_user (iov, args[1].p, args[2].i, false))
+    thread_exit (-1);
+  return process_writev (args[0].i, iov, args[2].i);
 }
 
 static int
-syscall_isdir (struct intr_frame *f)
+syscall_pread (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp +4);
-  return process_isdir (fd);
+  return process_pread (args[0].i, args[1].p, args[2].u, args[3].u);
 }
 
 static int
-syscall_inumber (struct intr_frame *f)
+syscall_pwrite (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int fd = *(int *) (f->esp +4);
-  return process_inumber (fd);
+  return process_pwrite (args[0].i, args[1].p, args[2].u, args[3].u);
 }
 
-static int get_user (uint8_t *uaddr)
+static int
+syscall_copy_file_range (const union syscall_arg *args,
+                         struct intr_frame *f UNUSED)
 {
-  int result;
-  asm ("movl $1f, %0; movzbl %1, %0; 1:"
-       : "=&a" (result) : "m" (*uaddr));
-  return result;
+  return process_copy_file_range (args[0].i, args[1].i, args[2].u);
 }
 
-static bool check_arguments (void *esp, int bytes)
+static int
+syscall_mkdir (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int i;
-  for (i = 0; i < bytes; i++)
-  {
-    if (get_user ((uint8_t *) (esp + i)) == -1 || 
-        !is_user_vaddr (esp + i))
-      return false;
-  }
-  return true;
+  if (args[0].s[0] == '\0')
+    return false;
+  return filesys_create (args[0].s, 0, true);
 }
 
-void
-syscall_init (void) 
+static int
+syscall_chdir (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  if (args[0].s[0] == '\0')
+    return false;
+  return filesys_chdir (args[0].s);
 }
 
-static void
-syscall_handler (struct intr_frame *f UNUSED) 
+static int
+syscall_readdir (const union syscall_arg *args, struct intr_frame *f UNUSED)
 {
-  int result = -1;
-  int return_status = 0;
-  if (!check_arguments (f->esp, 4))
-    {
-      thread_exit (-1);
-    }
+  char name[READDIR_MAX_LEN + 1];
 
-  /* Save esp context for check stack growth */
-  thread_current ()->esp = f->esp;
-  switch (*(int *) f->esp)
-    {
-      case SYS_HALT:
-        power_off ();
-        break;
+  if (!check_user_range (args[1].p, sizeof name, true))
+    thread_exit (-1);
+  if (!process_readdir (args[0].i, name))
+    return false;
+  if (!copy_to_user (args[1].p, name, strlen (name) + 1))
+    thread_exit (-1);
+  return true;
+}
 
-      case SYS_EXIT:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        syscall_exit (f);
-        break;
+static int
+syscall_isdir (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  return process_isdir (args[0].i);
+}
 
-      case SYS_EXEC:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_exec (f);
-        break;
+static int
+syscall_inumber (const union syscall_arg *args, struct intr_frame *f UNUSED)
+{
+  return process_inumber (args[0].i);
+}
 
-      case SYS_WAIT:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_wait (f);
-        break;
+/* Checks ARGS of system call SC according to their kinds.
+   Returns false if one is bad user memory. */
+static bool
+check_syscall_args (const struct syscall *sc, const union syscall_arg *args)
+{
+  int i;
 
-      case SYS_CREATE:
-        if (!check_arguments (f->esp + 4, 8))
-          goto bad_arg;
-        result = syscall_create (f, &return_status);
+  for (i = 0; i < sc->argc; i++)
+    switch (sc->kinds[i])
+      {
+      case ARG_INT:
+      case ARG_PTR:
         break;
-
-      case SYS_REMOVE:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_remove (f, &return_status);
+      case ARG_STR:
+        if (user_strnlen (args[i].s, PGSIZE) < 0)
+          return false;
         break;
-
-      case SYS_OPEN:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_open (f, &return_status);
+      case ARG_BUF_IN:
+      case ARG_BUF_OUT:
+        ASSERT (i + 1 < sc->argc);
+        if (!check_user_range (args[i].p, args[i + 1].u,
+                               sc->kinds[i] == ARG_BUF_OUT))
+          return false;
         break;
+      }
+  return true;
+}
 
-      case SYS_FILESIZE:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_filesize (f);
-        break;
+void
+syscall_init (void) 
+{
+  intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+}
 
-      case SYS_READ:
-        if (!check_arguments (f->esp + 4, 12))
-          goto bad_arg;
-        result = syscall_read (f, &return_status);
-        break;
+/* Handles a system call made through SYSENTER.  Called by
+   sysenter_entry in sysenter.S, with interrupts off. */
+void
+syscall_sysenter (struct intr_frame *f)
+{
+  intr_enable ();
+  syscall_handler (f);
+  intr_disable ();
+}
 
-      case SYS_WRITE:
-        if (!check_arguments (f->esp + 4, 12))
-            goto bad_arg;
-        result = syscall_write (f, &return_status);
-        break;
+/* Prints system call statistics. */
+void
+syscall_print_stats (void)
+{
+  size_t i;
 
-      case SYS_SEEK:
-        if (!check_arguments (f->esp + 4, 8))
-          goto bad_arg;
-        result = syscall_seek (f);
-        break;
+  for (i = 0; i < SYSCALL_CNT; i++)
+    if (syscalls[i].calls > 0)
+      printf ("Syscall: %s: %lld calls, %lld cycles average\n",
+              syscalls[i].name, syscalls[i].calls,
+              syscalls[i].cycles / syscalls[i].calls);
+}
 
-      case SYS_TELL:
-        if (!check_arguments (f->esp + 4, 8))
-          goto bad_arg;
-        result = syscall_tell (f);
-        break;
+static void
+syscall_handler (struct intr_frame *f) 
+{
+  union syscall_arg args[SYSCALL_MAX_ARGS];
+  struct syscall *sc;
+  enum intr_level old_level;
+  uint64_t start;
+  unsigned nr;
+  int result;
 
-      case SYS_CLOSE:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_close (f);
-        break;
+  /* Save esp context for check stack growth */
+  thread_current ()->esp = f->esp;
 
-      case SYS_MMAP:
-        if (!check_arguments (f->esp + 4, 8))
-          goto bad_arg;
-        result = syscall_mmap (f);
-        break;
+  /* Fetch system call number and all its arguments at once. */
+  if (!copy_from_user (&nr, f->esp, sizeof nr) || nr >= SYSCALL_CNT
+      || syscalls[nr].func == NULL)
+    thread_exit (-1);
+  sc = &syscalls[nr];
+  if (!copy_from_user (args, (uint8_t *) f->esp + sizeof nr,
+                       sc->argc * sizeof *args)
+      || !check_syscall_args (sc, args))
+    thread_exit (-1);
 
-      case SYS_MUNMAP:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_munmap (f);
-        break;
+  old_level = intr_disable ();
+  sc->calls++;
+  intr_set_level (old_level);
 
-      case SYS_CHDIR:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_chdir (f, &return_status);
-        break;
-      case SYS_MKDIR:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_mkdir (f, &return_status);
-        break;
-      case SYS_READDIR:
-        if (!check_arguments (f->esp + 4, 8))
-          goto bad_arg;
-        result = syscall_readdir (f, &return_status);
-        break;
-      case SYS_ISDIR:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_isdir (f);
-        break;
-      case SYS_INUMBER:
-        if (!check_arguments (f->esp + 4, 4))
-          goto bad_arg;
-        result = syscall_inumber (f);
-        break;
-    }
+  start = rdtsc ();
+  result = sc->func (args, f);
+
+  old_level = intr_disable ();
+  sc->cycles += rdtsc () - start;
+  intr_set_level (old_level);
 
   /* Reset esp context */
   thread_current ()->esp = NULL;
-  if (return_status == -1)
-    thread_exit (-1);
   f->eax = result;
-  return;
-bad_arg:
-  thread_exit (-1);
-  return;
 }
-
@@ -1,6 +1,17 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <stddef.h>
+
+struct intr_frame;
+
 void syscall_init (void);
+void syscall_sysenter (struct intr_frame *);
+void syscall_print_stats (void);
+
+bool copy_from_user (void *dst, const void *usrc, size_t size);
+bool copy_to_user (void *udst, const void *src, size_t size);
+int strncpy_from_user (char *dst, const char *usrc, size_t size);
 
 #endif /* userprog/syscall.h */
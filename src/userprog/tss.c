@@ -96,6 +96,15 @@ tss_get (void)
   return tss;
 }
 
+/* Returns the address of the ring 0 stack pointer in the TSS,
+   from which the SYSENTER entry stub loads its stack. */
+void *
+tss_esp0 (void)
+{
+  ASSERT (tss != NULL);
+  return &tss->esp0;
+}
+
 /* Sets the ring 0 stack pointer in the TSS to point to the end
    of the thread stack. */
 void
@@ -1,6 +1,8 @@
 #include <debug.h>
-#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
+#include "filesys/inode.h"
 #include "userprog/pagedir.h"
 #include "vm/frame.h"
 
@@ -21,6 +23,15 @@ struct evict_table
 static struct evict_table evict_table;  /* Eviction table described above */
 static struct hash frame_table;         /* Frame hash table for mamnaging frames */
 
+/* Share table for read-only file pages and mmaped pages, keyed by
+ * (inode sector, offset, read bytes, mmap or not). Mmaped pages can be
+ * written, so they never share frame with code of running executable. */
+static struct hash share_table;
+
+/* Caches of frame_entry and frame_sharer objects */
+static struct kmem_cache *frame_cache;
+static struct kmem_cache *sharer_cache;
+
 
 /* Hash function for hash data structures
  * Details are described below */
@@ -28,6 +39,13 @@ static unsigned frame_hash (const struct hash_elem *e, void *aux UNUSED);
 static bool frame_hash_less (const struct hash_elem *a,
                              const struct hash_elem *b,
                              void *aux UNUSED);
+static unsigned frame_share_hash (const struct hash_elem *e, void *aux UNUSED);
+static bool frame_share_less (const struct hash_elem *a,
+                              const struct hash_elem *b,
+                              void *aux UNUSED);
+
+/* Internal function that checks (and clears) accessed bits of frame */
+static bool frame_is_accessed (struct frame_entry *fe);
 
 
 /**
@@ -43,6 +61,12 @@ frame_init (void)
 	list_init (&evict_table.list);
 	evict_table.curr = NULL;
 	hash_init (&frame_table, frame_hash, frame_hash_less, NULL);
+	hash_init (&share_table, frame_share_hash, frame_share_less, NULL);
+	frame_cache = kmem_cache_create ("frame_entry", sizeof (struct frame_entry));
+	sharer_cache = kmem_cache_create ("frame_sharer",
+	                                  sizeof (struct frame_sharer));
+	if (frame_cache == NULL || sharer_cache == NULL)
+		PANIC ("frame_init: cannot create frame caches");
 }
 
 
@@ -59,7 +83,7 @@ frame_init (void)
 bool
 frame_add_page (void *paddr, void *vaddr)
 {
-	struct frame_entry *fe = malloc (sizeof (struct frame_entry));
+	struct frame_entry *fe = kmem_cache_alloc (frame_cache);
 	/* If there is no memory for allocate frame entry return false */
 	if (fe == NULL)
 		return false;
@@ -73,6 +97,14 @@ frame_add_page (void *paddr, void *vaddr)
 	 * owner should be needed */
 	fe->owner = thread_current ();
 
+	/* Frame is private until it is published by frame_share */
+	fe->is_shared = false;
+	fe->is_cached = false;
+	fe->ref_cnt = 1;
+	fe->pin_cnt = 0;
+	fe->is_freed = false;
+	list_init (&fe->sharers);
+
 	/* Insert entry into frame table and evict table */
 	hash_insert (&frame_table, &fe->elem_hash);
 	list_push_back (&evict_table.list, &fe->elem_list);
@@ -104,7 +136,8 @@ frame_get_entry (void *paddr)
 
 /**
  * \frame_free_page
- * \Delete frame entry from frame table and evict table
+ * \Delete frame entry from frame table and evict table.
+ * \Pinned frame entry is kept until frame_unpin.
  *
  * \param     fe  frame_entry which to be free
  *
@@ -116,6 +149,21 @@ frame_free_page (struct frame_entry *fe)
 	/* Delete entry from frame hash table */
 	hash_delete (&frame_table, &fe->elem_hash);
 
+	/* If frame is shared, remove it from share table and drop sharers */
+	if (fe->is_cached)
+	{
+		hash_delete (&share_table, &fe->elem_share);
+		if (fe->is_mmap)
+			inode_add_cached_pages (fe->inode, -1);
+	}
+	if (fe->is_shared)
+	{
+		while (!list_empty (&fe->sharers))
+			kmem_cache_free (sharer_cache,
+			                 list_entry (list_pop_front (&fe->sharers),
+			                             struct frame_sharer, elem));
+	}
+
 	/* If evict table points parameter's entry,
 	 * move to next entry */
 	if (&fe->elem_list == evict_table.curr)
@@ -124,8 +172,67 @@ frame_free_page (struct frame_entry *fe)
 	/* Remove from evict table */
 	list_remove (&fe->elem_list);
 
-	/* Free! */
-	free (fe);
+	/* Free! Unless it is still pinned */
+	if (fe->pin_cnt > 0)
+		fe->is_freed = true;
+	else
+		kmem_cache_free (frame_cache, fe);
+}
+
+
+/**
+ * \frame_release_page
+ * \Free physical frame and delete its frame entry.
+ * \Physical frame that is pinned is freed by frame_unpin instead.
+ *
+ * \param     fe  frame_entry which to be released
+ *
+ * \retval    void
+ */
+void
+frame_release_page (struct frame_entry *fe)
+{
+	if (fe->pin_cnt == 0)
+		palloc_free_page (fe->paddr);
+	frame_free_page (fe);
+}
+
+
+/**
+ * \frame_pin
+ * \Pin frame, so that it is neither evicted nor freed while it is
+ * \used without vm_frame_lock (e.g. written back to file).
+ * \Frame can be pinned several times.
+ *
+ * \param     fe  frame_entry to be pinned
+ *
+ * \retval    void
+ */
+void
+frame_pin (struct frame_entry *fe)
+{
+	fe->pin_cnt++;
+}
+
+
+/**
+ * \frame_unpin
+ * \Unpin frame, and free it if it was released meanwhile
+ * \and this was its last pin
+ *
+ * \param     fe  frame_entry to be unpinned
+ *
+ * \retval    void
+ */
+void
+frame_unpin (struct frame_entry *fe)
+{
+	ASSERT (fe->pin_cnt > 0);
+	if (--fe->pin_cnt == 0 && fe->is_freed)
+	{
+		palloc_free_page (fe->paddr);
+		kmem_cache_free (frame_cache, fe);
+	}
 }
 
 
@@ -151,19 +258,18 @@ frame_evict (void)
 			struct frame_entry *temp = list_entry(evict_table.curr,
 																						struct frame_entry,
 																	          elem_list);
-			struct thread *t = temp->owner;
 
-			/* Acquire lock for owner's page lock */
-			lock_acquire(&t->page_lock);
+			/* Pinned frame cannot be evicted, skip it */
+			if (temp->pin_cnt > 0)
+			{
+				evict_table.curr = list_next (evict_table.curr);
+				continue;
+			}
+
 			/* If entry is not accessed, imediately return it.
-			 * Otherwise, set accessed bit to false and continue */
-			if (!pagedir_is_accessed(t->pagedir, temp->vaddr)) {
-				lock_release(&t->page_lock);
+			 * Otherwise, accessed bit is cleared and continue */
+			if (!frame_is_accessed (temp))
 				return temp;
-			}
-			else
-				pagedir_set_accessed(t->pagedir, temp->vaddr, false);
-			lock_release(&t->page_lock);
 		}
 
 		/* As fifo queue is circular, rewinds the current position */
@@ -172,6 +278,257 @@ frame_evict (void)
 }
 
 
+/**
+ * \frame_apply
+ * \Call action for every frame entry in frame table.
+ * \Action should not insert or delete frame entry.
+ *
+ * \param   action  action for each hash element of frame entry
+ *
+ * \retval  void
+ */
+void
+frame_apply (hash_action_func *action)
+{
+	hash_apply (&frame_table, action);
+}
+
+
+/**
+ * \frame_get_shared
+ * \Find shared frame that caches page at offset ofs of inode sector
+ *
+ * \param   sector  inode sector of backing file
+ * \param   ofs     offset of page in backing file
+ * \param   read_bytes  bytes read from file (rest of page is zero)
+ * \param   is_mmap     true for frame of mmaped page
+ *
+ * \retval  NULL if there is no such frame
+ * \retval  struct frame_entry* if found
+ */
+struct frame_entry *
+frame_get_shared (disk_sector_t sector, off_t ofs, uint32_t read_bytes,
+                  bool is_mmap)
+{
+	struct frame_entry fe;
+	struct hash_elem *e;
+	fe.sector = sector;
+	fe.ofs = ofs;
+	fe.read_bytes = read_bytes;
+	fe.is_mmap = is_mmap;
+	e = hash_find (&share_table, &fe.elem_share);
+	return e != NULL ? hash_entry (e, struct frame_entry, elem_share) : NULL;
+}
+
+
+/**
+ * \frame_share
+ * \Publish private frame into share table, so other processes
+ * \mapping same page of file can use this frame.
+ * \Current owner of frame becomes the first sharer.
+ *
+ * \param   fe      frame entry to be shared
+ * \param   inode   backing inode (kept open by mmaped file while cached)
+ * \param   ofs     offset of page in backing file
+ * \param   read_bytes  bytes read from file (rest of page is zero)
+ * \param   is_mmap     true for frame of mmaped page
+ *
+ * \retval  true if success
+ * \retval  false if memory allocation fails or page is already shared
+ */
+bool
+frame_share (struct frame_entry *fe, struct inode *inode, off_t ofs,
+             uint32_t read_bytes, bool is_mmap)
+{
+	ASSERT (!fe->is_shared);
+
+	fe->sector = inode_get_inumber (inode);
+	fe->inode = inode;
+	fe->ofs = ofs;
+	fe->read_bytes = read_bytes;
+	fe->is_mmap = is_mmap;
+	if (hash_insert (&share_table, &fe->elem_share) != NULL)
+		return false;
+
+	if (!frame_make_shared (fe))
+	{
+		hash_delete (&share_table, &fe->elem_share);
+		return false;
+	}
+	fe->is_cached = true;
+
+	/* Reads and writes of file look in page cache only while
+	 * inode has mmaped frames in it */
+	if (is_mmap)
+		inode_add_cached_pages (inode, 1);
+	return true;
+}
+
+
+/**
+ * \frame_make_shared
+ * \Convert private frame into shared one which has
+ * \current owner as the first sharer. Do nothing if already shared.
+ *
+ * \param   fe      frame entry to be shared
+ *
+ * \retval  true if success
+ * \retval  false if memory allocation fails
+ */
+bool
+frame_make_shared (struct frame_entry *fe)
+{
+	if (fe->is_shared)
+		return true;
+
+	struct frame_sharer *fs = kmem_cache_alloc (sharer_cache);
+	if (fs == NULL)
+		return false;
+
+	fs->owner = fe->owner;
+	fs->vaddr = fe->vaddr;
+	list_push_back (&fe->sharers, &fs->elem);
+	fe->ref_cnt = 1;
+	fe->is_shared = true;
+	return true;
+}
+
+
+/**
+ * \frame_add_sharer
+ * \Add new mapping of shared frame
+ *
+ * \param   fe    shared frame entry
+ * \param   t     process that maps frame
+ * \param   vaddr user virtual address in t
+ *
+ * \retval  true if success
+ * \retval  false if memory allocation fails
+ */
+bool
+frame_add_sharer (struct frame_entry *fe, struct thread *t, void *vaddr)
+{
+	ASSERT (fe->is_shared);
+
+	struct frame_sharer *fs = kmem_cache_alloc (sharer_cache);
+	if (fs == NULL)
+		return false;
+
+	fs->owner = t;
+	fs->vaddr = vaddr;
+	list_push_back (&fe->sharers, &fs->elem);
+	fe->ref_cnt++;
+	return true;
+}
+
+
+/**
+ * \frame_remove_sharer
+ * \Remove mapping of shared frame. If removed mapping was
+ * \representative owner of frame, next sharer takes it over.
+ * \Copy-on-write frame with only one mapping left becomes private again.
+ *
+ * \param   fe    shared frame entry
+ * \param   t     process that maps frame
+ * \param   vaddr user virtual address in t
+ *
+ * \retval  true if it was the last mapping (frame should be freed)
+ * \retval  false otherwise
+ */
+bool
+frame_remove_sharer (struct frame_entry *fe, struct thread *t, void *vaddr)
+{
+	struct list_elem *e;
+
+	ASSERT (fe->is_shared);
+
+	for (e = list_begin (&fe->sharers); e != list_end (&fe->sharers);
+	     e = list_next (e))
+	{
+		struct frame_sharer *fs = list_entry (e, struct frame_sharer, elem);
+		if (fs->owner == t && fs->vaddr == vaddr)
+		{
+			list_remove (e);
+			kmem_cache_free (sharer_cache, fs);
+			fe->ref_cnt--;
+			break;
+		}
+	}
+
+	if (list_empty (&fe->sharers))
+		return true;
+
+	/* Hand over representative owner of frame to remaining sharer */
+	if (fe->owner == t && fe->vaddr == vaddr)
+	{
+		struct frame_sharer *fs = list_entry (list_front (&fe->sharers),
+		                                      struct frame_sharer, elem);
+		fe->owner = fs->owner;
+		fe->vaddr = fs->vaddr;
+	}
+
+	/* Frame not in share table is private if only one mapping is left */
+	if (!fe->is_cached && fe->ref_cnt == 1)
+	{
+		struct frame_sharer *fs = list_entry (list_pop_front (&fe->sharers),
+		                                      struct frame_sharer, elem);
+		fe->owner = fs->owner;
+		fe->vaddr = fs->vaddr;
+		kmem_cache_free (sharer_cache, fs);
+		fe->is_shared = false;
+	}
+	return false;
+}
+
+
+/**
+ * \internal
+ *
+ * \frame_is_accessed
+ * \Check frame is accessed by any of its mappings,
+ * \and clear accessed bits for second chance
+ *
+ * \param   fe  frame entry to be checked
+ *
+ * \retval  true if accessed recently
+ * \retval  false otherwise
+ */
+static bool
+frame_is_accessed (struct frame_entry *fe)
+{
+	struct list_elem *e;
+	bool accessed = false;
+
+	if (!fe->is_shared)
+	{
+		struct thread *t = fe->owner;
+
+		/* Acquire lock for owner's page lock */
+		lock_acquire (&t->page_lock);
+		accessed = pagedir_is_accessed (t->pagedir, fe->vaddr);
+		if (accessed)
+			pagedir_set_accessed (t->pagedir, fe->vaddr, false);
+		lock_release (&t->page_lock);
+		return accessed;
+	}
+
+	/* Shared frame is accessed if any of sharers accessed it */
+	for (e = list_begin (&fe->sharers); e != list_end (&fe->sharers);
+	     e = list_next (e))
+	{
+		struct frame_sharer *fs = list_entry (e, struct frame_sharer, elem);
+		lock_acquire (&fs->owner->page_lock);
+		if (pagedir_is_accessed (fs->owner->pagedir, fs->vaddr))
+		{
+			accessed = true;
+			pagedir_set_accessed (fs->owner->pagedir, fs->vaddr, false);
+		}
+		lock_release (&fs->owner->page_lock);
+	}
+	return accessed;
+}
+
+
 /***** hash function and less function for hash table initialization *****/
 
 /**
@@ -216,3 +573,51 @@ frame_hash_less (const struct hash_elem *a_,
 	struct frame_entry *b = hash_entry (b_, struct frame_entry, elem_hash);
 	return a->paddr < b->paddr;
 }
+
+
+/**
+ * \internal
+ *
+ * \frame_share_hash
+ * \Make hash of shared frame using inode sector and file offset
+ *
+ * \param   e  share hash element of frame entry
+ * \param   aux auxiliary data (UNUSED in this function)
+ *
+ * \retval  hash value
+ */
+static unsigned
+frame_share_hash (const struct hash_elem *e, void *aux UNUSED)
+{
+	struct frame_entry *fe = hash_entry (e, struct frame_entry, elem_share);
+	return hash_int ((int) fe->sector) ^ hash_int ((int) fe->ofs);
+}
+
+
+/**
+ * \internal
+ *
+ * \frame_share_less
+ * \Compare two shared frames with (sector, offset, read_bytes, is_mmap)
+ * \order
+ *
+ * \param  a_ ,b_  share hash element of frame entry
+ *
+ * \retval true if a's key is less than b's one.
+ * \retval false otherwise.
+ */
+static bool
+frame_share_less (const struct hash_elem *a_,
+                  const struct hash_elem *b_,
+                  void *aux UNUSED)
+{
+	struct frame_entry *a = hash_entry (a_, struct frame_entry, elem_share);
+	struct frame_entry *b = hash_entry (b_, struct frame_entry, elem_share);
+	if (a->sector != b->sector)
+		return a->sector < b->sector;
+	if (a->ofs != b->ofs)
+		return a->ofs < b->ofs;
+	if (a->read_bytes != b->read_bytes)
+		return a->read_bytes < b->read_bytes;
+	return a->is_mmap < b->is_mmap;
+}
@@ -3,6 +3,7 @@
 #include <hash.h>
 #include <list.h>
 #include "threads/thread.h"
+#include "filesys/off_t.h"
 
 /**
  * \frame entry
@@ -18,6 +19,33 @@ struct frame_entry
 
 	/* list element for list that implement fifo clock algorithm */
 	struct list_elem elem_list;
+
+	/* For pages shared between processes (read-only file page or
+	 * copy-on-write page after fork) */
+	bool is_shared;             /* Indicate sharers list is valid */
+	bool is_cached;             /* Indicate this frame is in share table */
+	disk_sector_t sector;       /* Inode sector of backing file */
+	struct inode *inode;        /* Backing inode, if cached for mmap */
+	off_t ofs;                  /* Offset of page in backing file */
+	uint32_t read_bytes;        /* Bytes read from file (rest is zero) */
+	bool is_mmap;               /* Cached for mmap, not for executable */
+	int ref_cnt;                /* Number of mappings of this frame */
+	int pin_cnt;                /* Users without lock, must not be freed */
+	bool is_freed;              /* Freed while pinned, free on unpin */
+	struct list sharers;        /* List of frame_sharer mapping this frame */
+	struct hash_elem elem_share; /* Hash element for share table */
+};
+
+
+/**
+ * \frame_sharer
+ * \One user mapping of a shared frame
+ */
+struct frame_sharer
+{
+	struct thread *owner;       /* Process that maps the frame */
+	void *vaddr;                /* User virtual address in owner */
+	struct list_elem elem;      /* List element for sharers of frame */
 };
 
 
@@ -25,6 +53,19 @@ void frame_init (void);
 bool frame_add_page (void *paddr, void *vaddr);
 struct frame_entry *frame_get_entry (void *paddr);
 void frame_free_page (struct frame_entry *fe);
+void frame_release_page (struct frame_entry *fe);
+void frame_pin (struct frame_entry *fe);
+void frame_unpin (struct frame_entry *fe);
 struct frame_entry *frame_evict (void);
+void frame_apply (hash_action_func *action);
+
+struct frame_entry *frame_get_shared (disk_sector_t sector, off_t ofs,
+                                      uint32_t read_bytes, bool is_mmap);
+bool frame_share (struct frame_entry *fe, struct inode *inode, off_t ofs,
+                  uint32_t read_bytes, bool is_mmap);
+bool frame_make_shared (struct frame_entry *fe);
+bool frame_add_sharer (struct frame_entry *fe, struct thread *t, void *vaddr);
+bool frame_remove_sharer (struct frame_entry *fe, struct thread *t,
+                          void *vaddr);
 
 #endif //OOOS_FRAME_H
@@ -2,7 +2,7 @@
 #include "page.h"
 #include "threads/thread.h"
 #include "threads/palloc.h"
-#include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
@@ -18,6 +18,57 @@ static bool page_hash_less (const struct hash_elem *_a,
 /* Hash action function for destroying hash table */
 static void page_destroy_action (struct hash_elem *e, void *aux UNUSED);
 
+/* Cache of page_entry objects */
+static struct kmem_cache *page_cache;
+
+
+/**
+ * \page_init
+ * \Initialize cache of supplemental page table entries
+ *
+ * \param   void
+ *
+ * \retval  void
+ */
+void
+page_init (void)
+{
+	page_cache = kmem_cache_create ("page_entry", sizeof (struct page_entry));
+	if (page_cache == NULL)
+		PANIC ("page_init: cannot create page_entry cache");
+}
+
+
+/**
+ * \page_alloc_entry
+ * \Allocate new supplemental page table entry
+ *
+ * \param   void
+ *
+ * \retval  new page_entry
+ * \retval  NULL if memory is not available
+ */
+struct page_entry *
+page_alloc_entry (void)
+{
+	return kmem_cache_alloc (page_cache);
+}
+
+
+/**
+ * \page_free_entry
+ * \Free supplemental page table entry allocated by page_alloc_entry
+ *
+ * \param   pe  entry to be freed
+ *
+ * \retval  void
+ */
+void
+page_free_entry (struct page_entry *pe)
+{
+	kmem_cache_free (page_cache, pe);
+}
+
 
 /**
  * \page_init_page
@@ -59,7 +110,7 @@ page_install_page (void *upage, void *kpage, bool writable,
 
 	/* Allocate memory, return false if not successfully allocated */
 	lock_acquire (&curr->page_lock);
-	struct page_entry *pe = malloc (sizeof (struct page_entry));
+	struct page_entry *pe = page_alloc_entry ();
 	if (pe == NULL)
 	{
 		lock_release (&curr->page_lock);
@@ -129,7 +180,7 @@ void
 page_delete_entry (struct hash *table, struct page_entry *spte)
 {
 	hash_delete (table, &spte->elem);
-	free (spte);
+	page_free_entry (spte);
 }
 
 
@@ -170,7 +221,7 @@ page_load_lazy (struct hash *table, struct file *file, off_t ofs,
                 bool writable, enum page_type type)
 {
 	/* Allocate page entry */
-	struct page_entry *spte = malloc (sizeof (struct page_entry));
+	struct page_entry *spte = page_alloc_entry ();
 	if (spte == NULL)
 		return NULL;
 
@@ -248,7 +299,7 @@ page_munmap (struct hash *table, struct page_entry *spte, void *pagedir)
 	/* Delete entry and set vaddr regin to be not present */
 	hash_delete (table, &spte->elem);
 	pagedir_clear_page (pagedir, spte->vaddr);
-	free (spte);
+	page_free_entry (spte);
 }
 
 
@@ -318,17 +369,19 @@ page_destroy_action (struct hash_elem *e, void *aux UNUSED)
 	if (pe->is_loaded)
 	{
 		paddr = pagedir_get_page (t->pagedir, pe->vaddr);
+		struct frame_entry *fe = frame_get_entry (paddr);
     if (pe->type == MMAP)
     {
       list_remove (&pe->elem_mmap);
-      if (pagedir_is_dirty (t->pagedir, pe->vaddr))
+      /* Pinned page may still be on its way to file, write it too */
+      if (pagedir_is_dirty (t->pagedir, pe->vaddr) || fe->pin_cnt > 0)
         file_write_at (pe->file, paddr, pe->read_bytes, pe->ofs);
     }
-		struct frame_entry *fe = frame_get_entry (paddr);
 		pagedir_clear_page (t->pagedir, pe->vaddr);
-		palloc_free_page (fe->paddr);
-		frame_free_page (fe);
-		free (pe);
+		/* Shared frame is freed only when last sharer leaves */
+		if (!fe->is_shared || frame_remove_sharer (fe, t, pe->vaddr))
+			frame_release_page (fe);
+		page_free_entry (pe);
 		return;
 	}
 
@@ -350,7 +403,7 @@ page_destroy_action (struct hash_elem *e, void *aux UNUSED)
 	}
 
 	/* Free!! */
-	free (pe);
+	page_free_entry (pe);
 }
 
 
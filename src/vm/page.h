@@ -54,6 +54,9 @@ struct page_entry
 };
 
 
+void page_init (void);
+struct page_entry *page_alloc_entry (void);
+void page_free_entry (struct page_entry *pe);
 void page_init_page (void);
 bool page_install_page (void *upage, void *kpage, bool writable,
                         enum palloc_flags flags, enum page_type type);
@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include "swap.h"
+#include "threads/malloc.h"
 /* Not swapped index is set false,
  * if in use set true */
 
@@ -26,6 +27,12 @@ void swap_init (void)
 	/* Create pool with num_pages */
 	swap_table.swap_pool = bitmap_create (num_pages);
 
+	/* Block evicted from frame shared after fork is shared by every
+	 * process that mapped the frame, count them */
+	swap_table.ref_cnts = calloc (num_pages, sizeof *swap_table.ref_cnts);
+	if (swap_table.swap_pool == NULL || swap_table.ref_cnts == NULL)
+		PANIC ("swap_init: cannot create swap table");
+
 	/* Init lock */
 	lock_init (&swap_table.swap_lock);
 }
@@ -42,11 +49,14 @@ void swap_init (void)
 size_t swap_write (void *kpage)
 {
 	/* Find available swap block and set to unavailable */
+	lock_acquire (&swap_table.swap_lock);
 	size_t swap_idx = bitmap_scan_and_flip (swap_table.swap_pool, 10, 1, false);
 
 	/* If there is no block to write, PANIC :( */
 	if (swap_idx == BITMAP_ERROR)
 		PANIC ("Swap disk is full :(");
+	swap_table.ref_cnts[swap_idx] = 1;
+	lock_release (&swap_table.swap_lock);
 
 	/* As consecutive 8 block is 1 page, page is divided into 8 blocks
 	 * and written into disk */
@@ -62,9 +72,28 @@ size_t swap_write (void *kpage)
 }
 
 
+/**
+ * \swap_share
+ * \Add one more page that is stored in swap block idx.
+ * \Block is freed after every page has read or deleted it.
+ *
+ * \param idx index of swap block
+ *
+ * \retval void
+ */
+void swap_share (size_t idx)
+{
+	lock_acquire (&swap_table.swap_lock);
+	ASSERT (swap_table.ref_cnts[idx] > 0);
+	swap_table.ref_cnts[idx]++;
+	lock_release (&swap_table.swap_lock);
+}
+
+
 /**
  * \swap_read
- * \Read the data from disk
+ * \Read the data from disk, and free block if no other page
+ * \is stored in it
  *
  * \param kpage destination for swap in
  *
@@ -88,8 +117,9 @@ bool swap_read (size_t idx, void *kpage)
 		           kpage + i * DISK_SECTOR_SIZE);
 	}
 
-	/* Flip the bit located idx */
-	bitmap_flip (swap_table.swap_pool, idx);
+	/* Flip the bit located idx, if this was last page in block */
+	if (--swap_table.ref_cnts[idx] == 0)
+		bitmap_flip (swap_table.swap_pool, idx);
 
 	lock_release (&swap_table.swap_lock);
 
@@ -99,7 +129,8 @@ bool swap_read (size_t idx, void *kpage)
 
 /**
  * \swap_delete
- * \Delete swap block, just flip the bit
+ * \Delete page from swap block, just flip the bit
+ * \if no other page is stored in it
  *
  * \param idx index to be deleted
  *
@@ -107,5 +138,8 @@ bool swap_read (size_t idx, void *kpage)
  */
 void swap_delete (size_t idx)
 {
-	bitmap_flip (swap_table.swap_pool, idx);
+	lock_acquire (&swap_table.swap_lock);
+	if (--swap_table.ref_cnts[idx] == 0)
+		bitmap_flip (swap_table.swap_pool, idx);
+	lock_release (&swap_table.swap_lock);
 }
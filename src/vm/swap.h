@@ -13,6 +13,7 @@ struct swap_table
 {
 	struct disk *swap_disk;   /* Indicate swap disk */
 	struct bitmap *swap_pool; /* Indicate available block */
+	int *ref_cnts;            /* Number of pages that share each block */
 	struct lock swap_lock;    /* Lock for pool synchronization */
 };
 
@@ -20,6 +21,7 @@ struct swap_table
 void swap_init (void);
 bool swap_read (size_t idx, void *kapge);
 size_t swap_write (void *kpage);
+void swap_share (size_t idx);
 void swap_delete (size_t idx);
 
 
@@ -1,8 +1,14 @@
 #include <hash.h>
 #include <list.h>
+#include <string.h>
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/pte.h"
+#include "devices/timer.h"
+#include "filesys/inode.h"
 #include "userprog/process.h"
 #include "userprog/pagedir.h"
 #include "vm/vm.h"
@@ -11,6 +17,36 @@
 
 static struct lock vm_frame_lock; /* Lock for synch vm system */
 
+/* Number of 4 kB pages in a 4 MB page */
+#define VM_LARGE_PAGE_CNT (PTSPAN / PGSIZE)
+
+/* Interval of periodic writeback of dirty mmaped pages (in ticks) */
+#define VM_WRITEBACK_TICKS TIMER_FREQ
+
+/* Timer callout that wakes up writeback demon */
+static struct callout vm_writeback_callout;
+static struct semaphore vm_writeback_sema;
+
+/**
+ * \vm_writeback
+ * \Dirty mmaped frame that writeback demon collected (and pinned)
+ * \under vm_frame_lock, to be written back after releasing it
+ */
+struct vm_writeback
+{
+	struct frame_entry *fe;     /* Pinned frame to be written */
+	struct inode *inode;        /* Backing file (reopened) */
+	off_t ofs;                  /* Offset of page in backing file */
+	uint32_t read_bytes;        /* Bytes to be written */
+	struct list_elem elem;      /* List element for vm_writeback_list */
+};
+
+/* Frames collected by writeback demon */
+static struct list vm_writeback_list;
+
+/* Loaded mmaped pages that writeback demon saw in its last pass */
+static size_t vm_writeback_mmap_cnt;
+
 
 /* Internal function for swap in */
 static bool vm_swap_in (struct page_entry *spte);
@@ -18,6 +54,43 @@ static bool vm_swap_in (struct page_entry *spte);
 /* Interbal function for load on demand */
 static bool vm_load_demand (struct page_entry *spte);
 
+/* Internal function for load file page through share table (page cache) */
+static bool vm_load_shared (struct page_entry *spte);
+static uint32_t vm_cache_bytes (struct page_entry *spte);
+
+/* Internal functions for load zero pages with 4 MB page */
+static bool vm_load_large (struct page_entry *spte);
+static bool vm_is_large_candidate (struct thread *t, void *vaddr);
+
+/* Internal functions for writeback of dirty mmaped pages */
+static void vm_writeback_page (struct thread *t, struct page_entry *spte);
+static struct page_entry *vm_writeback_take (struct thread *t, void *vaddr);
+static void vm_writeback_frame (struct hash_elem *e, void *aux UNUSED);
+static void vm_periodic_writeback (void *aux);
+static void vm_writeback_timeout (void *aux);
+static void vm_arm_writeback (void);
+
+/* Internal function for read/write file through page cache */
+static off_t vm_file_io (struct file *file, void *buffer, off_t size,
+                         off_t pos, bool write);
+static off_t vm_file_write_cached (struct file *file, disk_sector_t sector,
+                                   off_t page_ofs, const void *buffer,
+                                   uint8_t *bounce, off_t chunk, off_t pos);
+static bool vm_file_cached (struct file *file, off_t pos, off_t size);
+static off_t vm_file_iov (struct file *file, const struct iovec *iov,
+                          int iovcnt, off_t pos, bool write);
+
+/* Internal function that unmaps shared frame from every sharer */
+static void vm_unmap_shared (struct frame_entry *fe);
+
+/* Internal functions for frame allocation and eviction */
+static void *vm_alloc_frame (enum palloc_flags flags, void *vaddr);
+static void vm_evict_page (struct thread *t, void *vaddr, void *paddr,
+                           size_t *swap_idx);
+
+/* Internal function for duplicating page entry in fork */
+static bool vm_fork_page (struct thread *parent, struct page_entry *pe);
+
 
 /**
  * \vm_init
@@ -30,11 +103,22 @@ static bool vm_load_demand (struct page_entry *spte);
 void
 vm_init (void)
 {
-	/* Init frame lock and call frame_init and swap_init in
-	 * frame.c and swap.c, respectively */
+	/* Init frame lock and call page_init, frame_init and swap_init in
+	 * page.c, frame.c and swap.c, respectively */
 	lock_init (&vm_frame_lock);
+	page_init ();
 	frame_init ();
 	swap_init ();
+
+	struct semaphore sem;
+	sema_init (&sem, 0);
+	sema_init (&vm_writeback_sema, 0);
+	list_init (&vm_writeback_list);
+
+	/* Make new thread for periodically write back dirty mmaped pages */
+	thread_create ("writeback", PRI_DEFAULT, vm_periodic_writeback,
+	               (void *) &sem);
+	sema_down (&sem);
 }
 
 
@@ -127,78 +211,117 @@ vm_init_page (void)
 void *
 vm_get_page (enum palloc_flags flags, void *vaddr)
 {
-
 	/* If not User page allocation request, return NULL */
 	if (!(flags & PAL_USER))
 		return NULL;
 
 	lock_acquire (&vm_frame_lock);
+	void *paddr = vm_alloc_frame (flags, vaddr);
+	lock_release (&vm_frame_lock);
+	return paddr;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_alloc_frame
+ * \Get physical page from user pool, evict a frame if pool is exhausted,
+ * \and add it to frame table (vm_frame_lock should be held)
+ *
+ * \param flags palloc flag
+ * \param vaddr virtual page address
+ *
+ * \retval address of physical page
+ * \retval NULL if allocation failed
+ */
+static void *
+vm_alloc_frame (enum palloc_flags flags, void *vaddr)
+{
+	ASSERT (lock_held_by_current_thread (&vm_frame_lock));
+
 	/* Get page from user pool */
 	void *paddr = palloc_get_page (flags);
 
-	if (paddr != NULL)
-	{
-		/* If allocation available, add it to frame table and return */
-		if (!frame_add_page (paddr, vaddr))
-		{
-			palloc_free_page (paddr);
-			lock_release (&vm_frame_lock);
-			return NULL;
-		}
-		lock_release (&vm_frame_lock);
-		return paddr;
-	}
-	else
+	if (paddr == NULL)
 	{
 		/* palloc is not available, eviction occurs */
 		/* Find entry to be evicted */
 		struct frame_entry *fe = frame_evict ();
 
-		lock_acquire (&fe->owner->page_lock);
-
-		struct page_entry *spte = page_get_entry (&fe->owner->page_table, fe->vaddr);
-
-		/* If victim page is mmaped region */
-		if (spte->type == MMAP)
-		{
-			/* If dirty, write back to file */
-			if (pagedir_is_dirty(fe->owner->pagedir, fe->vaddr))
-				file_write_at (spte->file, fe->paddr, spte->read_bytes, spte->ofs);
-		}
-		else if (spte->type != FILE ||
-				pagedir_is_dirty (fe->owner->pagedir, fe->vaddr))
+		/* Shared frame is unmapped from every process,
+		 * otherwise only from its owner */
+		if (fe->is_shared)
+			vm_unmap_shared (fe);
+		else
 		{
-			/* If this is not file and dirty, write to swap disk */
-			size_t swap_idx = swap_write (fe->paddr);
-			spte->block_idx = swap_idx;
-			spte->type = DISK;
+			size_t swap_idx = BITMAP_ERROR;
+			vm_evict_page (fe->owner, fe->vaddr, fe->paddr, &swap_idx);
 		}
 
-		/* Set sup.page entry loaded flag to false */
-		spte->is_loaded = false;
-		/* Clear page table entry (set present bit invalid */
-		pagedir_clear_page (fe->owner->pagedir, fe->vaddr);
-		lock_release (&fe->owner->page_lock);
-
-		/* Free page */
-		palloc_free_page (fe->paddr);
-
-		/* Remove frame entry corresponding to paddr */
-		frame_free_page (fe);
+		/* Free page and remove frame entry corresponding to paddr */
+		frame_release_page (fe);
 
 		/* Re allocate for request */
 		paddr = palloc_get_page (flags);
+	}
 
-		/* Add it to frame table */
-		if (!frame_add_page (paddr, vaddr))
-		{
-			palloc_free_page (paddr);
-			lock_release (&vm_frame_lock);
-			return NULL;
-		}
-		lock_release (&vm_frame_lock);
-		return paddr;
+	/* Add it to frame table */
+	if (!frame_add_page (paddr, vaddr))
+	{
+		palloc_free_page (paddr);
+		return NULL;
+	}
+	return paddr;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_evict_page
+ * \Unmap user page vaddr of process t that mapped to frame paddr,
+ * \writing it back to file or swap disk if needed.
+ * \Frame is written to swap disk only once, and shared by
+ * \every mapping of it that is evicted with same swap_idx.
+ *
+ * \param t     process that maps frame
+ * \param vaddr user virtual address in t
+ * \param paddr physical address of frame
+ * \param swap_idx  swap block of frame, BITMAP_ERROR if not written yet
+ *
+ * \retval void
+ */
+static void
+vm_evict_page (struct thread *t, void *vaddr, void *paddr, size_t *swap_idx)
+{
+	lock_acquire (&t->page_lock);
+
+	struct page_entry *spte = page_get_entry (&t->page_table, vaddr);
+
+	/* If victim page is mmaped region */
+	if (spte->type == MMAP)
+	{
+		/* If dirty, write back to file */
+		if (pagedir_is_dirty (t->pagedir, vaddr))
+			file_write_at (spte->file, paddr, spte->read_bytes, spte->ofs);
+	}
+	else if (spte->type != FILE || pagedir_is_dirty (t->pagedir, vaddr))
+	{
+		/* If this is not file and dirty, write to swap disk */
+		if (*swap_idx == BITMAP_ERROR)
+			*swap_idx = swap_write (paddr);
+		else
+			swap_share (*swap_idx);
+		spte->block_idx = *swap_idx;
+		spte->type = DISK;
 	}
+
+	/* Set sup.page entry loaded flag to false */
+	spte->is_loaded = false;
+	/* Clear page table entry (set present bit invalid */
+	pagedir_clear_page (t->pagedir, vaddr);
+	lock_release (&t->page_lock);
 }
 
 
@@ -244,8 +367,7 @@ vm_free_page (void *paddr)
 	lock_release (&fe->owner->page_lock);
 
 	/* Remove frame entry and free physical page */
-	palloc_free_page (fe->paddr);
-	frame_free_page (fe);
+	frame_release_page (fe);
 	lock_release (&vm_frame_lock);
 }
 
@@ -350,6 +472,17 @@ vm_swap_in (struct page_entry *spte)
 static bool
 vm_load_demand (struct page_entry *spte)
 {
+	/* Read-only file pages (i.e. code) and mmaped pages are
+	 * loaded through page cache shared between processes */
+	if (spte->type == MMAP)
+		vm_arm_writeback ();
+	if ((spte->type == FILE && !spte->writable) || spte->type == MMAP)
+		return vm_load_shared (spte);
+
+	/* Zero pages (i.e. large bss) are loaded by 4 MB page if possible */
+	if (spte->type == FILE && spte->read_bytes == 0 && vm_load_large (spte))
+		return true;
+
 	void *paddr = vm_get_page (spte->flags, spte->vaddr);
 	if (paddr == NULL)
 		return false;
@@ -370,113 +503,1159 @@ vm_load_demand (struct page_entry *spte)
 }
 
 /**
- * \vm_add_mmap
- * \Mmap the given file
+ * \internal
  *
- * \param   file    file to be mmaped
- * \param   start_addr  address for starting mmap (user virtual address)
- * \param   file_size   size of given file
+ * \vm_load_shared
+ * \Load read-only file page. If other process already loaded same page
+ * \of same file, just map that frame. Otherwise load page into new
+ * \frame and publish it into share table.
  *
- * \retval  mmap entry if successful
- * \retval  Null if failed
+ * \param   spte  faulted supplemental page table entry
+ *
+ * \retval  true  if loading in memory success
+ * \retval  false if failed
  */
-struct mmap_entry *
-vm_add_mmap (struct file *file, void *start_addr, size_t file_size)
+static bool
+vm_load_shared (struct page_entry *spte)
 {
 	struct thread *curr = thread_current ();
-	struct hash *sup_pt = &curr->page_table;
-	struct mmap_entry *me = malloc (sizeof (struct mmap_entry));
-	if (me == NULL)
-		return NULL;
-
-	lock_acquire (&curr->page_lock);
-	/* Initialize mmap entry */
-	me->file = file;
-	list_init (&me->map_list);
-	list_init (&me->fd_list);
+	disk_sector_t sector = file_get_inumber (spte->file);
+	uint32_t cache_bytes = vm_cache_bytes (spte);
+	bool is_mmap = spte->type == MMAP;
+	struct frame_entry *fe;
+	bool success;
 
-	bool ret = true;
-
-	/* Load lazily given file */
-	off_t ofs = 0;
-	while (file_size > 0)
+	/* Find page in share table */
+	lock_acquire (&vm_frame_lock);
+	fe = frame_get_shared (sector, spte->ofs, cache_bytes, is_mmap);
+	if (fe != NULL)
 	{
-		size_t read_bytes = file_size < PGSIZE ? file_size : PGSIZE;
-		size_t zero_bytes = PGSIZE - read_bytes;
-
-		if (page_get_entry (sup_pt, start_addr))
+		if (!frame_add_sharer (fe, curr, spte->vaddr))
 		{
-			ret = false;
-			break;
+			lock_release (&vm_frame_lock);
+			return false;
 		}
 
-		/* Add supplemental page entry */
-		struct page_entry *temp = page_load_lazy (sup_pt, file, ofs, start_addr,
-																						  read_bytes, zero_bytes, true,
-																							MMAP);
-		if (temp == NULL)
-		{
-			ret = false;
-			break;
-		}
-		list_push_back (&me->map_list, &temp->elem_mmap);
+		lock_acquire (&curr->page_lock);
+		success = install_page (spte->vaddr, fe->paddr, spte->writable);
+		spte->is_loaded = success;
+		lock_release (&curr->page_lock);
 
-		file_size -= read_bytes;
-		ofs += read_bytes;
-		start_addr += PGSIZE;
+		if (!success)
+			frame_remove_sharer (fe, curr, spte->vaddr);
+		lock_release (&vm_frame_lock);
+		return success;
 	}
+	lock_release (&vm_frame_lock);
 
-	/* Mmap failed */
-	if (ret == false)
+	/* Not found, load it in private frame */
+	void *paddr = vm_get_page (spte->flags, spte->vaddr);
+	if (paddr == NULL)
+		return false;
+
+	lock_acquire (&curr->page_lock);
+	if (!page_load_demand (spte, paddr))
 	{
-		struct list_elem *e;
-		for (e = list_begin (&me->map_list); e != list_end (&me->map_list);
-			   e = list_next (e))
-			page_delete_entry (sup_pt,
-			                   list_entry (e, struct page_entry, elem_mmap));
-		free (me);
-		return NULL;
+		vm_free_page (paddr);
+		lock_release (&curr->page_lock);
+		return false;
 	}
-	list_push_back (&curr->mmap_list, &me->elem);
 	lock_release (&curr->page_lock);
 
-	me->mid = curr->mapid_next++;
-	return me;
+	/* Publish loaded frame, unless it is already evicted or other process
+	 * published same page meanwhile (then it just remains private) */
+	lock_acquire (&vm_frame_lock);
+	fe = frame_get_entry (paddr);
+	if (fe != NULL && fe->owner == curr && fe->vaddr == spte->vaddr
+	    && !fe->is_shared
+	    && frame_get_shared (sector, spte->ofs, cache_bytes, is_mmap) == NULL)
+		frame_share (fe, file_get_inode (spte->file), spte->ofs, cache_bytes,
+		             is_mmap);
+	lock_release (&vm_frame_lock);
+	return true;
 }
 
 
 /**
- * \vm_munmap
- * \Unmap the mmap entry
+ * \internal
  *
- * \param   me  mmap entry that mmaped
+ * \vm_unmap_shared
+ * \Unmap shared frame from every process mapping it.
+ * \Read-only file pages are clean, so they are just loaded again from file.
+ * \Copy-on-write pages are written to swap disk once, and every
+ * \sharer refers to that one swap block.
+ * \(vm_frame_lock should be held)
+ *
+ * \param   fe  shared frame entry
+ *
+ * \retval  void
+ */
+static void
+vm_unmap_shared (struct frame_entry *fe)
+{
+	struct list_elem *e;
+	size_t swap_idx = BITMAP_ERROR;
+
+	ASSERT (lock_held_by_current_thread (&vm_frame_lock));
+
+	for (e = list_begin (&fe->sharers); e != list_end (&fe->sharers);
+	     e = list_next (e))
+	{
+		struct frame_sharer *fs = list_entry (e, struct frame_sharer, elem);
+		vm_evict_page (fs->owner, fs->vaddr, fe->paddr, &swap_idx);
+	}
+}
+
+
+/**
+ * \vm_msync
+ * \Write back dirty pages of mmap entry to file,
+ * \and clear their dirty bits.
+ *
+ * \param   me  mmap entry to be synchronized
  *
  * \retval  void
  */
 void
-vm_munmap (struct mmap_entry *me)
+vm_msync (struct mmap_entry *me)
 {
 	struct thread *curr = thread_current ();
-	struct page_entry *spte;
+	struct list_elem *e;
 
-	/* Remove allocated page in mmap entry
-	 * As mmap entry containes list of consecutive virtual pages */
-	while (!list_empty (&me->map_list))
+	lock_acquire (&vm_frame_lock);
+	lock_acquire (&curr->page_lock);
+	for (e = list_begin (&me->map_list); e != list_end (&me->map_list);
+	     e = list_next (e))
+		vm_writeback_page (curr, list_entry (e, struct page_entry, elem_mmap));
+	lock_release (&curr->page_lock);
+	lock_release (&vm_frame_lock);
+}
+
+
+/**
+ * \vm_file_read
+ * \Read file from current position like file_read,
+ * \but pages cached by page cache (i.e. mmaped) are read from cached frame.
+ *
+ * \param   file    file to read
+ * \param   buffer  destination buffer
+ * \param   size    bytes to read
+ *
+ * \retval  bytes actually read
+ */
+off_t
+vm_file_read (struct file *file, void *buffer, off_t size)
+{
+	off_t bytes = vm_file_io (file, buffer, size, file_tell (file), false);
+	file_seek (file, file_tell (file) + bytes);
+	return bytes;
+}
+
+
+/**
+ * \vm_file_write
+ * \Write file from current position like file_write.
+ * \Data is written through to file, and also into cached frame if
+ * \page is in page cache, so mmaped pages see the data immediately.
+ *
+ * \param   file    file to write
+ * \param   buffer  source buffer
+ * \param   size    bytes to write
+ *
+ * \retval  bytes actually written
+ */
+off_t
+vm_file_write (struct file *file, const void *buffer, off_t size)
+{
+	off_t bytes = vm_file_io (file, (void *) buffer, size, file_tell (file),
+	                          true);
+	file_seek (file, file_tell (file) + bytes);
+	return bytes;
+}
+
+
+/**
+ * \vm_file_read_at
+ * \Read file from given position like file_read_at, through page cache.
+ *
+ * \param   file    file to read
+ * \param   buffer  destination buffer
+ * \param   size    bytes to read
+ * \param   pos     file offset to read from
+ *
+ * \retval  bytes actually read
+ */
+off_t
+vm_file_read_at (struct file *file, void *buffer, off_t size, off_t pos)
+{
+	return vm_file_io (file, buffer, size, pos, false);
+}
+
+
+/**
+ * \vm_file_write_at
+ * \Write file at given position like file_write_at, through page cache.
+ *
+ * \param   file    file to write
+ * \param   buffer  source buffer
+ * \param   size    bytes to write
+ * \param   pos     file offset to write to
+ *
+ * \retval  bytes actually written
+ */
+off_t
+vm_file_write_at (struct file *file, const void *buffer, off_t size,
+                  off_t pos)
+{
+	return vm_file_io (file, (void *) buffer, size, pos, true);
+}
+
+
+/**
+ * \vm_file_readv
+ * \Read file from current position into several buffers in order.
+ *
+ * \param   file    file to read
+ * \param   iov     destination buffers
+ * \param   iovcnt  number of buffers
+ *
+ * \retval  bytes actually read
+ */
+off_t
+vm_file_readv (struct file *file, const struct iovec *iov, int iovcnt)
+{
+	off_t bytes = vm_file_iov (file, iov, iovcnt, file_tell (file), false);
+	file_seek (file, file_tell (file) + bytes);
+	return bytes;
+}
+
+
+/**
+ * \vm_file_writev
+ * \Write file at current position from several buffers in order.
+ *
+ * \param   file    file to write
+ * \param   iov     source buffers
+ * \param   iovcnt  number of buffers
+ *
+ * \retval  bytes actually written
+ */
+off_t
+vm_file_writev (struct file *file, const struct iovec *iov, int iovcnt)
+{
+	off_t bytes = vm_file_iov (file, iov, iovcnt, file_tell (file), true);
+	file_seek (file, file_tell (file) + bytes);
+	return bytes;
+}
+
+
+/**
+ * \vm_file_copy
+ * \Copy size bytes from current position of src to current position of
+ * \dst inside kernel, advancing both positions. If no page of either
+ * \range is in page cache, which is usual, data moves through buffer
+ * \cache only, otherwise through a kernel page and page cache.
+ *
+ * \param   dst   file to write
+ * \param   src   file to read
+ * \param   size  bytes to copy
+ *
+ * \retval  bytes actually copied
+ */
+off_t
+vm_file_copy (struct file *dst, struct file *src, off_t size)
+{
+	off_t src_pos = file_tell (src);
+	off_t dst_pos = file_tell (dst);
+	off_t done = 0;
+
+	if (file_get_inumber (src) != file_get_inumber (dst)
+	    && !vm_file_cached (src, src_pos, size)
+	    && !vm_file_cached (dst, dst_pos, size))
+		done = file_copy_range (dst, dst_pos, src, src_pos, size);
+	else
 	{
-		spte = list_entry (list_pop_front (&me->map_list),
-											 struct page_entry,
-										   elem_mmap);
-		if (spte->is_loaded)
+		uint8_t *bounce = palloc_get_page (0);
+		if (bounce == NULL)
+			return 0;
+		while (done < size)
 		{
-			void *paddr = pagedir_get_page (curr->pagedir, spte->vaddr);
-			struct frame_entry *fe = frame_get_entry (paddr);
-			if (pagedir_is_dirty (curr->pagedir, spte->vaddr))
-				file_write_at(spte->file, fe->paddr, spte->read_bytes, spte->ofs);
-
-			vm_free_page (paddr);
+			off_t chunk = size - done < PGSIZE ? size - done : PGSIZE;
+			off_t bytes = vm_file_io (src, bounce, chunk, src_pos + done, false);
+			if (bytes > 0)
+				bytes = vm_file_io (dst, bounce, bytes, dst_pos + done, true);
+			if (bytes <= 0)
+				break;
+			done += bytes;
+			if (bytes != chunk)
+				break;
 		}
-		else
-			page_delete_entry (&curr->page_table, spte);
+		palloc_free_page (bounce);
 	}
-	return;
+
+	if (done > 0)
+	{
+		file_seek (src, src_pos + done);
+		file_seek (dst, dst_pos + done);
+	}
+	return done;
+}
+
+
+/**
+ * \vm_fork
+ * \Duplicate supplemental page table of parent into current process.
+ * \Loaded pages are shared with parent and mapped read-only in both,
+ * \so that writable ones are copied on first write (see vm_copy_on_write).
+ * \Swapped pages share their swap blocks with parent, and memory mapped
+ * \files are not inherited.
+ * \(Parent should be blocked until this function returns)
+ *
+ * \param   parent  process to be duplicated
+ *
+ * \retval  true  if success
+ * \retval  false if failed
+ */
+bool
+vm_fork (struct thread *parent)
+{
+	struct thread *curr = thread_current ();
+	struct hash_iterator i;
+	bool success = true;
+
+	lock_acquire (&vm_frame_lock);
+	lock_acquire (&parent->page_lock);
+	lock_acquire (&curr->page_lock);
+
+	hash_first (&i, &parent->page_table);
+	while (success && hash_next (&i))
+	{
+		struct page_entry *pe = hash_entry (hash_cur (&i), struct page_entry, elem);
+		success = vm_fork_page (parent, pe);
+	}
+
+	lock_release (&curr->page_lock);
+	lock_release (&parent->page_lock);
+	lock_release (&vm_frame_lock);
+	return success;
+}
+
+
+/**
+ * \vm_copy_on_write
+ * \Handles write fault on present page. If page is writable but mapped
+ * \read-only since it is shared after fork, copy it into private frame
+ * \(or just make it writable if no one else maps it anymore).
+ *
+ * \param fault_addr  address that fault occurred
+ *
+ * \retval  true if page fault is properly handled.
+ * \retval  false otherwise.
+ */
+bool
+vm_copy_on_write (void *fault_addr)
+{
+	struct thread *curr = thread_current ();
+	void *upage = pg_round_down (fault_addr);
+
+	if (!is_user_vaddr (fault_addr))
+		return false;
+
+	lock_acquire (&vm_frame_lock);
+	lock_acquire (&curr->page_lock);
+	struct page_entry *spte = page_get_entry (&curr->page_table, upage);
+	void *paddr = pagedir_get_page (curr->pagedir, upage);
+	lock_release (&curr->page_lock);
+
+	/* Writing read-only page, not proper case */
+	if (spte == NULL || !spte->writable)
+	{
+		lock_release (&vm_frame_lock);
+		return false;
+	}
+
+	/* Page is evicted after fault, just retry */
+	if (paddr == NULL)
+	{
+		lock_release (&vm_frame_lock);
+		return true;
+	}
+
+	struct frame_entry *fe = frame_get_entry (paddr);
+	if (fe->is_shared && fe->ref_cnt > 1)
+	{
+		/* Allocate private frame, eviction can occur meanwhile */
+		void *kpage = vm_alloc_frame (spte->flags, upage);
+		if (kpage == NULL)
+		{
+			lock_release (&vm_frame_lock);
+			return false;
+		}
+
+		lock_acquire (&curr->page_lock);
+		if (pagedir_get_page (curr->pagedir, upage) != paddr)
+		{
+			/* Shared frame is evicted, retry fault with swapped page */
+			lock_release (&curr->page_lock);
+			frame_release_page (frame_get_entry (kpage));
+			lock_release (&vm_frame_lock);
+			return true;
+		}
+
+		/* Copy content and remap it writable */
+		memcpy (kpage, paddr, PGSIZE);
+		pagedir_clear_page (curr->pagedir, upage);
+		pagedir_set_page (curr->pagedir, upage, kpage, true);
+		pagedir_set_dirty (curr->pagedir, upage, true);
+		lock_release (&curr->page_lock);
+
+		if (frame_remove_sharer (fe, curr, upage))
+		{
+			frame_release_page (fe);
+		}
+	}
+	else
+	{
+		/* No one else maps this frame, just make it writable again */
+		lock_acquire (&curr->page_lock);
+		pagedir_set_writable (curr->pagedir, upage, true);
+		lock_release (&curr->page_lock);
+	}
+
+	lock_release (&vm_frame_lock);
+	return true;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_fork_page
+ * \Duplicate parent's page entry into current process
+ *
+ * \param   parent  process to be duplicated
+ * \param   pe      parent's supplemental page entry
+ *
+ * \retval  true  if success
+ * \retval  false if failed
+ */
+static bool
+vm_fork_page (struct thread *parent, struct page_entry *pe)
+{
+	struct thread *curr = thread_current ();
+
+	/* Memory mapped files are not inherited */
+	if (pe->type == MMAP)
+		return true;
+
+	struct page_entry *spte = page_alloc_entry ();
+	if (spte == NULL)
+		return false;
+	memcpy (spte, pe, sizeof (struct page_entry));
+
+	/* Lazily loaded pages are read from child's own executable */
+	if (spte->type == FILE)
+		spte->file = curr->excutable;
+
+	if (!pe->is_loaded)
+	{
+		/* Swapped page shares parent's swap block instead of copying it */
+		if (pe->type == DISK)
+			swap_share (pe->block_idx);
+		hash_insert (&curr->page_table, &spte->elem);
+		return true;
+	}
+
+	/* Share frame with parent */
+	void *paddr = pagedir_get_page (parent->pagedir, pe->vaddr);
+	struct frame_entry *fe = frame_get_entry (paddr);
+	if (!frame_make_shared (fe) || !frame_add_sharer (fe, curr, pe->vaddr))
+	{
+		page_free_entry (spte);
+		return false;
+	}
+
+	/* Map read-only in both process, and keep dirty bit of parent
+	 * so that eviction writes the page to swap disk */
+	if (!pagedir_set_page (curr->pagedir, pe->vaddr, fe->paddr, false))
+	{
+		frame_remove_sharer (fe, curr, pe->vaddr);
+		page_free_entry (spte);
+		return false;
+	}
+	if (pagedir_is_dirty (parent->pagedir, pe->vaddr))
+		pagedir_set_dirty (curr->pagedir, pe->vaddr, true);
+	pagedir_set_writable (parent->pagedir, pe->vaddr, false);
+
+	hash_insert (&curr->page_table, &spte->elem);
+	return true;
+}
+
+/**
+ * \vm_add_mmap
+ * \Mmap the given file
+ *
+ * \param   file    file to be mmaped
+ * \param   start_addr  address for starting mmap (user virtual address)
+ * \param   file_size   size of given file
+ *
+ * \retval  mmap entry if successful
+ * \retval  Null if failed
+ */
+struct mmap_entry *
+vm_add_mmap (struct file *file, void *start_addr, size_t file_size)
+{
+	struct thread *curr = thread_current ();
+	struct hash *sup_pt = &curr->page_table;
+	struct mmap_entry *me = malloc (sizeof (struct mmap_entry));
+	if (me == NULL)
+		return NULL;
+
+	lock_acquire (&curr->page_lock);
+	/* Initialize mmap entry */
+	me->file = file;
+	list_init (&me->map_list);
+
+	bool ret = true;
+
+	/* Load lazily given file */
+	off_t ofs = 0;
+	while (file_size > 0)
+	{
+		size_t read_bytes = file_size < PGSIZE ? file_size : PGSIZE;
+		size_t zero_bytes = PGSIZE - read_bytes;
+
+		if (page_get_entry (sup_pt, start_addr))
+		{
+			ret = false;
+			break;
+		}
+
+		/* Add supplemental page entry */
+		struct page_entry *temp = page_load_lazy (sup_pt, file, ofs, start_addr,
+																						  read_bytes, zero_bytes, true,
+																							MMAP);
+		if (temp == NULL)
+		{
+			ret = false;
+			break;
+		}
+		list_push_back (&me->map_list, &temp->elem_mmap);
+
+		file_size -= read_bytes;
+		ofs += read_bytes;
+		start_addr += PGSIZE;
+	}
+
+	/* Mmap failed */
+	if (ret == false)
+	{
+		struct list_elem *e;
+		for (e = list_begin (&me->map_list); e != list_end (&me->map_list);
+			   e = list_next (e))
+			page_delete_entry (sup_pt,
+			                   list_entry (e, struct page_entry, elem_mmap));
+		lock_release (&curr->page_lock);
+		free (me);
+		return NULL;
+	}
+	lock_release (&curr->page_lock);
+
+	me->mid = idtable_insert (&curr->mmaps, me);
+	if (me->mid == MAP_FAILED)
+	{
+		vm_munmap (me);
+		free (me);
+		return NULL;
+	}
+	return me;
+}
+
+
+/**
+ * \vm_munmap
+ * \Unmap the mmap entry
+ *
+ * \param   me  mmap entry that mmaped
+ *
+ * \retval  void
+ */
+void
+vm_munmap (struct mmap_entry *me)
+{
+	struct thread *curr = thread_current ();
+	struct page_entry *spte;
+
+	lock_acquire (&vm_frame_lock);
+	lock_acquire (&curr->page_lock);
+
+	/* Remove allocated page in mmap entry
+	 * As mmap entry containes list of consecutive virtual pages */
+	while (!list_empty (&me->map_list))
+	{
+		spte = list_entry (list_pop_front (&me->map_list),
+											 struct page_entry,
+										   elem_mmap);
+		if (spte->is_loaded)
+		{
+			void *paddr = pagedir_get_page (curr->pagedir, spte->vaddr);
+			struct frame_entry *fe = frame_get_entry (paddr);
+			/* Pinned page may still be on its way to file, write it too */
+			if (pagedir_is_dirty (curr->pagedir, spte->vaddr) || fe->pin_cnt > 0)
+				file_write_at(spte->file, fe->paddr, spte->read_bytes, spte->ofs);
+			pagedir_clear_page (curr->pagedir, spte->vaddr);
+
+			/* Cached page is freed only when last sharer unmaps it */
+			if (!fe->is_shared || frame_remove_sharer (fe, curr, spte->vaddr))
+				frame_release_page (fe);
+		}
+		page_delete_entry (&curr->page_table, spte);
+	}
+
+	lock_release (&curr->page_lock);
+	lock_release (&vm_frame_lock);
+	return;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_cache_bytes
+ * \Bytes of file that page cache entry of spte covers. Mmaped page
+ * \holds whole file page (zero after end of file), so it is keyed
+ * \as full page regardless of read_bytes.
+ *
+ * \param   spte  supplemental page entry
+ *
+ * \retval  bytes used as share table key
+ */
+static uint32_t
+vm_cache_bytes (struct page_entry *spte)
+{
+	return spte->type == MMAP ? PGSIZE : spte->read_bytes;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_file_io
+ * \Read or write file page by page, using page cache if page is cached.
+ * \User buffer can fault while copying, so data is moved between user
+ * \buffer and cached frame through kernel bounce page without holding
+ * \vm_frame_lock.
+ *
+ * \param   file    file to read or write
+ * \param   buffer  user buffer
+ * \param   size    bytes to read or write
+ * \param   pos     file offset to start at
+ * \param   write   true if write, false if read
+ *
+ * \retval  bytes actually read or written
+ */
+static off_t
+vm_file_io (struct file *file, void *buffer, off_t size, off_t pos,
+            bool write)
+{
+	disk_sector_t sector = file_get_inumber (file);
+	off_t done = 0;
+	uint8_t *bounce = NULL;
+
+	/* No page of file is mmaped, which is usual, use file directly */
+	if (!inode_has_cached_pages (file_get_inode (file)))
+		return write ? file_write_at (file, buffer, size, pos)
+		             : file_read_at (file, buffer, size, pos);
+
+	while (size > 0)
+	{
+		off_t page_ofs = pos - pos % PGSIZE;
+		off_t chunk = PGSIZE - pos % PGSIZE;
+		off_t bytes;
+		struct frame_entry *fe;
+		if (chunk > size)
+			chunk = size;
+
+		if (!write)
+		{
+			/* Do not read after end of file */
+			off_t left = file_length (file) - pos;
+			if (left <= 0)
+				break;
+			if (chunk > left)
+				chunk = left;
+		}
+
+		lock_acquire (&vm_frame_lock);
+		fe = frame_get_shared (sector, page_ofs, PGSIZE, true);
+		lock_release (&vm_frame_lock);
+
+		/* Page is not cached, use file directly */
+		if (fe == NULL)
+		{
+			bytes = write ? file_write_at (file, buffer + done, chunk, pos)
+			              : file_read_at (file, buffer + done, chunk, pos);
+		}
+		else
+		{
+			if (bounce == NULL && (bounce = palloc_get_page (0)) == NULL)
+				break;
+
+			if (write)
+				bytes = vm_file_write_cached (file, sector, page_ofs,
+				                              buffer + done, bounce, chunk, pos);
+			else
+			{
+				/* Frame can be evicted while copying, so find it again */
+				bytes = chunk;
+				lock_acquire (&vm_frame_lock);
+				fe = frame_get_shared (sector, page_ofs, PGSIZE, true);
+				if (fe != NULL)
+					memcpy (bounce, fe->paddr + pos % PGSIZE, bytes);
+				lock_release (&vm_frame_lock);
+
+				if (fe == NULL)
+					bytes = file_read_at (file, bounce, chunk, pos);
+				memcpy (buffer + done, bounce, bytes);
+			}
+		}
+
+		done += bytes;
+		pos += bytes;
+		size -= bytes;
+		if (bytes != chunk)
+			break;
+	}
+
+	if (bounce != NULL)
+		palloc_free_page (bounce);
+	return done;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_file_write_cached
+ * \Write chunk of user buffer into page of file that is in page cache.
+ * \Data goes into cached frame first, and file is written from the
+ * \frame, pinned meanwhile, so writeback of frame by eviction or
+ * \writeback demon can never put older data over it.
+ *
+ * \param   file      file to write
+ * \param   sector    inode sector of file
+ * \param   page_ofs  offset of cached page in file
+ * \param   buffer    user buffer
+ * \param   bounce    kernel page for copying user buffer
+ * \param   chunk     bytes to write, within the page
+ * \param   pos       file offset to start at
+ *
+ * \retval  bytes actually written
+ */
+static off_t
+vm_file_write_cached (struct file *file, disk_sector_t sector,
+                      off_t page_ofs, const void *buffer, uint8_t *bounce,
+                      off_t chunk, off_t pos)
+{
+	struct frame_entry *fe;
+	off_t bytes;
+
+	/* User buffer can fault, so copy it without vm_frame_lock */
+	memcpy (bounce, buffer, chunk);
+
+	/* Frame can be evicted while copying, so find it again */
+	lock_acquire (&vm_frame_lock);
+	fe = frame_get_shared (sector, page_ofs, PGSIZE, true);
+	if (fe == NULL)
+	{
+		/* Write with lock held, so page is not loaded again from file
+		 * before new data is in it */
+		bytes = file_write_at (file, bounce, chunk, pos);
+		lock_release (&vm_frame_lock);
+		return bytes;
+	}
+	memcpy (fe->paddr + pos % PGSIZE, bounce, chunk);
+	frame_pin (fe);
+	lock_release (&vm_frame_lock);
+
+	bytes = file_write_at (file, fe->paddr + pos % PGSIZE, chunk, pos);
+
+	lock_acquire (&vm_frame_lock);
+	frame_unpin (fe);
+	lock_release (&vm_frame_lock);
+	return bytes;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_file_cached
+ * \Check whether any page of file between pos and pos + size is in
+ * \page cache.
+ *
+ * \param   file    file to check
+ * \param   pos     file offset of range
+ * \param   size    bytes of range
+ *
+ * \retval  true if some page is cached
+ * \retval  false otherwise
+ */
+static bool
+vm_file_cached (struct file *file, off_t pos, off_t size)
+{
+	disk_sector_t sector = file_get_inumber (file);
+	off_t page_ofs;
+	bool cached = false;
+
+	if (!inode_has_cached_pages (file_get_inode (file)))
+		return false;
+
+	lock_acquire (&vm_frame_lock);
+	for (page_ofs = pos - pos % PGSIZE; !cached && page_ofs < pos + size;
+	     page_ofs += PGSIZE)
+		cached = frame_get_shared (sector, page_ofs, PGSIZE, true) != NULL;
+	lock_release (&vm_frame_lock);
+	return cached;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_file_iov
+ * \Read or write file from several buffers in order. If no page of the
+ * \file is in page cache, which is usual, whole vector is passed to
+ * \inode in one call, otherwise each buffer goes through vm_file_io.
+ *
+ * \param   file    file to read or write
+ * \param   iov     user buffers
+ * \param   iovcnt  number of buffers
+ * \param   pos     file offset to start at
+ * \param   write   true if write, false if read
+ *
+ * \retval  bytes actually read or written
+ */
+static off_t
+vm_file_iov (struct file *file, const struct iovec *iov, int iovcnt,
+             off_t pos, bool write)
+{
+	off_t done = 0;
+	int i;
+
+	if (!inode_has_cached_pages (file_get_inode (file)))
+		return write ? file_writev_at (file, iov, iovcnt, pos)
+		             : file_readv_at (file, iov, iovcnt, pos);
+
+	for (i = 0; i < iovcnt; i++)
+	{
+		off_t bytes = vm_file_io (file, iov[i].iov_base, iov[i].iov_len,
+		                          pos + done, write);
+		done += bytes;
+		if (bytes != (off_t) iov[i].iov_len)
+			break;
+	}
+	return done;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_writeback_page
+ * \If mmaped page is loaded and dirty, clear its dirty bit
+ * \and write it back to file. Page pinned by writeback demon is
+ * \written too, as demon may not have written it yet.
+ * \(vm_frame_lock and page_lock of t should be held)
+ *
+ * \param   t     process that maps page
+ * \param   spte  supplemental page entry of t
+ *
+ * \retval  void
+ */
+static void
+vm_writeback_page (struct thread *t, struct page_entry *spte)
+{
+	if (spte == NULL || spte->type != MMAP || !spte->is_loaded)
+		return;
+
+	void *paddr = pagedir_get_page (t->pagedir, spte->vaddr);
+	if (!pagedir_is_dirty (t->pagedir, spte->vaddr)
+	    && frame_get_entry (paddr)->pin_cnt == 0)
+		return;
+
+	/* Clear dirty bit first, so write during writeback makes it dirty again */
+	pagedir_set_dirty (t->pagedir, spte->vaddr, false);
+	file_write_at (spte->file, paddr, spte->read_bytes, spte->ofs);
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_writeback_take
+ * \If page vaddr of t is loaded dirty mmaped page, clear its dirty bit
+ * \and return its supplemental page entry. Loaded mmaped pages are
+ * \counted in vm_writeback_mmap_cnt.
+ * \(vm_frame_lock should be held)
+ *
+ * \param   t      process that maps page
+ * \param   vaddr  user virtual address in t
+ *
+ * \retval  supplemental page entry if page was dirty
+ * \retval  NULL otherwise
+ */
+static struct page_entry *
+vm_writeback_take (struct thread *t, void *vaddr)
+{
+	struct page_entry *spte;
+
+	lock_acquire (&t->page_lock);
+	spte = page_get_entry (&t->page_table, vaddr);
+	if (spte != NULL && spte->type == MMAP && spte->is_loaded)
+		vm_writeback_mmap_cnt++;
+	if (spte == NULL || spte->type != MMAP || !spte->is_loaded
+	    || !pagedir_is_dirty (t->pagedir, vaddr))
+		spte = NULL;
+	else
+		pagedir_set_dirty (t->pagedir, vaddr, false);
+	lock_release (&t->page_lock);
+	return spte;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_writeback_frame
+ * \Hash action that clears dirty bits of every mmaped mapping of frame,
+ * \and if any was dirty, pins frame and adds it to vm_writeback_list.
+ * \Frame is written once even if several processes dirtied it.
+ * \(vm_frame_lock should be held)
+ *
+ * \param   e    hash element of frame entry
+ * \param   aux  auxiliary data (UNUSED)
+ *
+ * \retval  void
+ */
+static void
+vm_writeback_frame (struct hash_elem *e, void *aux UNUSED)
+{
+	struct frame_entry *fe = hash_entry (e, struct frame_entry, elem_hash);
+	struct page_entry *spte = NULL;
+	struct list_elem *le;
+
+	if (!fe->is_shared)
+		spte = vm_writeback_take (fe->owner, fe->vaddr);
+	else
+		for (le = list_begin (&fe->sharers); le != list_end (&fe->sharers);
+		     le = list_next (le))
+		{
+			struct frame_sharer *fs = list_entry (le, struct frame_sharer, elem);
+			struct page_entry *taken = vm_writeback_take (fs->owner, fs->vaddr);
+			if (spte == NULL)
+				spte = taken;
+		}
+	if (spte == NULL)
+		return;
+
+	/* Without memory for list entry, write it right here */
+	struct vm_writeback *wb = malloc (sizeof *wb);
+	if (wb == NULL)
+	{
+		file_write_at (spte->file, fe->paddr, spte->read_bytes, spte->ofs);
+		return;
+	}
+
+	/* Hold own reference of inode, as file can be closed by munmap */
+	wb->fe = fe;
+	wb->inode = inode_reopen (file_get_inode (spte->file));
+	wb->ofs = spte->ofs;
+	wb->read_bytes = spte->read_bytes;
+	frame_pin (fe);
+	list_push_back (&vm_writeback_list, &wb->elem);
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_periodic_writeback
+ * \Demon thread that periodically writes back dirty mmaped pages,
+ * \so that dirty data does not pile up until munmap or exit.
+ * \Dirty frames are collected under vm_frame_lock, but written
+ * \after releasing it, so page faults are not blocked by disk.
+ * \Demon runs only while mmaped pages are loaded: its timer is armed
+ * \by loading mmaped page, and re-armed only if a pass found one.
+ *
+ * \param   aux  semaphore to signal that demon started
+ *
+ * \retval  void
+ */
+static void
+vm_periodic_writeback (void *aux)
+{
+	sema_up ((struct semaphore *) aux);
+
+	/* This is writeback demon, run until program done. */
+	while (1)
+	{
+		/* Sleep until timer expires */
+		sema_down (&vm_writeback_sema);
+
+		lock_acquire (&vm_frame_lock);
+		vm_writeback_mmap_cnt = 0;
+		frame_apply (vm_writeback_frame);
+		if (vm_writeback_mmap_cnt > 0)
+			vm_arm_writeback ();
+		lock_release (&vm_frame_lock);
+
+		/* Pinned frame is neither evicted nor freed during write */
+		while (!list_empty (&vm_writeback_list))
+		{
+			struct list_elem *le = list_pop_front (&vm_writeback_list);
+			struct vm_writeback *wb = list_entry (le, struct vm_writeback, elem);
+			inode_write_at (wb->inode, wb->fe->paddr, wb->read_bytes, wb->ofs);
+			inode_close (wb->inode);
+
+			lock_acquire (&vm_frame_lock);
+			frame_unpin (wb->fe);
+			lock_release (&vm_frame_lock);
+			free (wb);
+		}
+	}
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_writeback_timeout
+ * \Timer callout (runs in interrupt context) that wakes up
+ * \writeback demon.
+ *
+ * \param   aux  unused
+ *
+ * \retval  void
+ */
+static void
+vm_writeback_timeout (void *aux UNUSED)
+{
+	if (vm_writeback_sema.value == 0)
+		sema_up (&vm_writeback_sema);
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_arm_writeback
+ * \Arm writeback callout, unless it is already pending
+ *
+ * \param   void
+ *
+ * \retval  void
+ */
+static void
+vm_arm_writeback (void)
+{
+	enum intr_level old_level = intr_disable ();
+	if (!vm_writeback_callout.pending)
+		timer_add_callout (&vm_writeback_callout, VM_WRITEBACK_TICKS,
+		                   vm_writeback_timeout, NULL);
+	intr_set_level (old_level);
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_load_large
+ * \Load whole 4 MB region containing spte with one 4 MB page,
+ * \if every page in region is unloaded writable zero page and
+ * \aligned contiguous frames are available in user pool.
+ * \Frame table keeps entry for each 4 kB frame, so the 4 MB page is
+ * \split into 4 kB pages when any of them is evicted.
+ *
+ * \param   spte  supplemental page entry of faulted page
+ *
+ * \retval  true if region is loaded
+ * \retval  false if not possible (caller falls back to 4 kB page)
+ */
+static bool
+vm_load_large (struct page_entry *spte)
+{
+	struct thread *curr = thread_current ();
+	uint8_t *base = (uint8_t *) ((uintptr_t) spte->vaddr & PDE_LARGE_ADDR);
+	uint8_t *kpage;
+	size_t i, added;
+	bool success = true;
+
+	if (!large_pages)
+		return false;
+
+	/* Check both ends first, to fail fast for small region */
+	lock_acquire (&curr->page_lock);
+	success = vm_is_large_candidate (curr, base)
+	          && vm_is_large_candidate (curr, base + PTSPAN - PGSIZE);
+	for (i = 1; success && i < VM_LARGE_PAGE_CNT - 1; i++)
+		success = vm_is_large_candidate (curr, base + i * PGSIZE);
+	lock_release (&curr->page_lock);
+	if (!success)
+		return false;
+
+	/* Get aligned contiguous frames, no eviction for this */
+	kpage = palloc_get_multiple (PAL_USER | PAL_ZERO | PAL_ALIGN,
+	                             VM_LARGE_PAGE_CNT);
+	if (kpage == NULL)
+		return false;
+
+	lock_acquire (&vm_frame_lock);
+	lock_acquire (&curr->page_lock);
+
+	/* Add each frame to frame table */
+	for (added = 0; added < VM_LARGE_PAGE_CNT; added++)
+		if (!frame_add_page (kpage + added * PGSIZE, base + added * PGSIZE))
+			break;
+
+	success = added == VM_LARGE_PAGE_CNT
+	          && pagedir_set_large_page (curr->pagedir, base, kpage, true);
+	if (success)
+	{
+		for (i = 0; i < VM_LARGE_PAGE_CNT; i++)
+			page_get_entry (&curr->page_table, base + i * PGSIZE)->is_loaded = true;
+	}
+	else
+	{
+		/* Roll back, and fall back to 4 kB page */
+		for (i = 0; i < added; i++)
+			frame_free_page (frame_get_entry (kpage + i * PGSIZE));
+		palloc_free_multiple (kpage, VM_LARGE_PAGE_CNT);
+	}
+
+	lock_release (&curr->page_lock);
+	lock_release (&vm_frame_lock);
+	return success;
+}
+
+
+/**
+ * \internal
+ *
+ * \vm_is_large_candidate
+ * \Check page can be a part of 4 MB zero page
+ * \(page_lock of t should be held)
+ *
+ * \param   t      process
+ * \param   vaddr  user virtual page address
+ *
+ * \retval  true if vaddr is unloaded writable zero page
+ * \retval  false otherwise
+ */
+static bool
+vm_is_large_candidate (struct thread *t, void *vaddr)
+{
+	struct page_entry *spte = page_get_entry (&t->page_table, vaddr);
+	return spte != NULL && spte->type == FILE && spte->writable
+	       && !spte->is_loaded && spte->read_bytes == 0;
 }
@@ -13,8 +13,6 @@ struct mmap_entry
 	struct file *file;
 	mapid_t mid;
 	struct list map_list;
-	struct list fd_list;
-	struct list_elem elem;
 };
 
 
@@ -37,4 +35,19 @@ struct mmap_entry *vm_add_mmap (struct file *file,
                                 void *start_addr,
                                 size_t file_size);
 void vm_munmap (struct mmap_entry *me);
+void vm_msync (struct mmap_entry *me);
+
+off_t vm_file_read (struct file *file, void *buffer, off_t size);
+off_t vm_file_write (struct file *file, const void *buffer, off_t size);
+off_t vm_file_read_at (struct file *file, void *buffer, off_t size,
+                       off_t pos);
+off_t vm_file_write_at (struct file *file, const void *buffer, off_t size,
+                        off_t pos);
+off_t vm_file_readv (struct file *file, const struct iovec *iov, int iovcnt);
+off_t vm_file_writev (struct file *file, const struct iovec *iov,
+                      int iovcnt);
+off_t vm_file_copy (struct file *dst, struct file *src, off_t size);
+
+bool vm_fork (struct thread *parent);
+bool vm_copy_on_write (void *fault_addr);
 #endif //VM_VM_H